@@ -18,4 +18,10 @@
 // void-return function pointer type
 typedef void (*func_ptr_t)();
 
+// Time in seconds and nanoseconds
+typedef struct {
+    int tv_sec;                 // seconds
+    int tv_nsec;                // nanoseconds (0 to 999999999)
+} timespec_t;
+
 #endif
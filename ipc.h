@@ -9,15 +9,80 @@ typedef enum {
 
 typedef int sem_t;
 
+// Condition variable, reader-writer lock and event handles; like sem_t they
+// start out as SEMAPHORE_UNINITIALIZED and are assigned by their init call
+typedef int cond_t;
+typedef int rwlock_t;
+typedef int event_t;
+
+// Event flag wait modes
+#define EVENT_WAIT_ANY 0x0         // wake when any bit of the mask is set
+#define EVENT_WAIT_ALL 0x1         // wake when every bit of the mask is set
+#define EVENT_WAIT_CLEAR 0x2       // clear the mask bits on waking (or-ed in)
+
+// Futex-backed semaphore; the counter lives in user memory and the kernel
+// is only entered to sleep or to wake a sleeper
+typedef struct fsem_t {
+    volatile int value;             // Available permits
+    volatile int waiters;           // Processes sleeping in the kernel
+} fsem_t;
+
+#define FSEM_INITIALIZER(value) { (value), 0 }
+
 // Message definitions
 #define MSG_SIZE 256
 
+// Number of message priorities (0 is lowest and the default)
+#define MSG_PRIO_MAX 4
+
 // Message data structure
 typedef struct msg_t {
     int sender;                     // Sending PID
-    int time_sent;                  // Time sent
-    int time_received;              // Time received
+    int time_sent;                  // Time sent (seconds)
+    int time_received;              // Time received (seconds)
+    int time_sent_nsec;             // Nanoseconds past time_sent
+    int time_received_nsec;         // Nanoseconds past time_received
+    int priority;                   // Delivery priority (0 to MSG_PRIO_MAX-1)
     unsigned char data[MSG_SIZE];   // Message data
 } msg_t;
 
+// Sender of messages posted by an interval timer
+#define MSG_SENDER_TIMER -2
+
+// Sender of asynchronous I/O completions
+#define MSG_SENDER_AIO -3
+
+// Data of a message posted by an interval timer
+typedef struct timer_msg_t {
+    int timer;                      // Timer handle
+    int expirations;                // Periods elapsed since the last one received
+} timer_msg_t;
+
+// Maximum number of mailboxes (or semaphores) in a single select set
+#define MSG_SELECT_MAX 8
+
+// Set of mailboxes and semaphores to wait on with msg_select()
+typedef struct msg_select_t {
+    int mbox_count;                 // Number of mailboxes in mbox[]
+    int mbox[MSG_SELECT_MAX];       // Mailbox handles to wait on
+    int mbox_ready[MSG_SELECT_MAX]; // Set to 1 if the mailbox has a message
+    int sem_count;                  // Number of semaphores in sem[]
+    sem_t sem[MSG_SELECT_MAX];      // Semaphore identifiers to wait on
+    int sem_ready[MSG_SELECT_MAX];  // Set to 1 if the semaphore is available
+} msg_select_t;
+
+// Broadcast channel policies for slow subscribers
+typedef enum {
+    CHAN_DROP_OLDEST,               // overwrite the oldest unread message
+    CHAN_BLOCK_PUBLISHER            // block the publisher until a slot frees
+} chan_policy_e;
+
+// Number of message words ipc_call/ipc_reply_wait carry in registers
+#define IPC_REG_WORDS 4
+
+// Short register-only message (words travel in ecx, edx, esi, edi)
+typedef struct ipc_regs_t {
+    int w[IPC_REG_WORDS];
+} ipc_regs_t;
+
 #endif
@@ -0,0 +1,172 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Asynchronous I/O
+ *
+ * aio_submit() starts an operation and returns at once; the result is
+ * posted to a mailbox as an aio_completion_t message when the operation
+ * finishes, so a process can keep several in flight and collect them with
+ * msg_recv() or msg_select(). Block operations go through the buffer cache;
+ * file operations finish before aio_submit() returns but still complete
+ * through the mailbox. A mailbox slot is reserved for each completion when
+ * the operation is submitted, so posting it never fails.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kaio.h"
+#include "kbcache.h"
+#include "kfs.h"
+#include "ksyscall.h"
+#include "string.h"
+
+static aio_slot_t aio_slots[AIO_MAX];
+
+/**
+ * Initializes asynchronous I/O
+ */
+void kaio_init() {
+    sp_memset(aio_slots, 0, sizeof(aio_slots));
+}
+
+/**
+ * Posts the completion of an operation into the mailbox slot reserved for
+ * it and frees the operation's slot
+ * @param  slot   - slot of the operation
+ * @param  status - 0 on success, -1 on error
+ * @param  bytes  - bytes transferred
+ */
+static void kaio_complete(int slot, int status, int bytes) {
+    aio_completion_t *done;
+    msg_t msg;
+    int mbox_num;
+
+    aio_slots[slot].in_use = 0;
+
+    // The mailbox, and its reservation with it, may have been destroyed
+    // in the meantime
+    mbox_num = mbox_lookup(aio_slots[slot].mbox);
+    if (mbox_num < 0) {
+        return;
+    }
+
+    sp_memset(&msg, 0, sizeof(msg_t));
+    done = (aio_completion_t *)msg.data;
+    done->cookie = aio_slots[slot].cookie;
+    done->status = status;
+    done->bytes = bytes;
+
+    mbox_unreserve(mbox_num);
+    if (mbox_post(mbox_num, &msg, MSG_SENDER_AIO) != 0) {
+        panic("AIO COMPLETION LOST");
+    }
+}
+
+/**
+ * Completion of a block operation
+ * @param  req - finished buffer cache request
+ */
+static void kaio_blk_done(blk_req_t *req) {
+    kaio_complete(req->arg, req->status, req->done * BLOCK_SIZE);
+}
+
+/**
+ * Drops the outstanding operations of an exiting process
+ * @param  pid - exiting process
+ */
+void kaio_reclaim(int pid) {
+    int mbox_num;
+    int i;
+
+    // Block operations are the only ones that outlive aio_submit()
+    kbcache_reclaim(pid);
+
+    for (i = 0; i < AIO_MAX; i++) {
+        if (aio_slots[i].in_use && aio_slots[i].owner == pid) {
+            aio_slots[i].in_use = 0;
+
+            // Nothing will be posted into its mailbox slot now
+            mbox_num = mbox_lookup(aio_slots[i].mbox);
+            if (mbox_num >= 0) {
+                mbox_unreserve(mbox_num);
+            }
+        }
+    }
+}
+
+/**
+ * Starts an asynchronous operation
+ * @param  req   - operation to start (copied; req->buf must stay valid)
+ * @param  owner - submitting process
+ * @return 0 if the operation was started, -1 if it is invalid, too many
+ *         are outstanding or its mailbox has no room for the completion
+ */
+int kaio_submit(aio_req_t *req, int owner) {
+    int mbox_num;
+    int slot;
+    int rc;
+
+    if (req == NULL || req->buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    if ((req->op != AIO_READ && req->op != AIO_WRITE) || req->len < 0) {
+        return -1;
+    }
+
+    mbox_num = mbox_lookup(req->mbox);
+    if (mbox_num < 0 || mailboxes[mbox_num].msg_size < (int)sizeof(aio_completion_t)) {
+        return -1;
+    }
+
+    for (slot = 0; slot < AIO_MAX && aio_slots[slot].in_use; slot++);
+    if (slot == AIO_MAX) {
+        return -1;
+    }
+
+    // Hold a mailbox slot for the completion so that other senders cannot
+    // fill the mailbox before the operation finishes
+    if (mbox_reserve(mbox_num) != 0) {
+        return -1;
+    }
+
+    aio_slots[slot].in_use = 1;
+    aio_slots[slot].owner = owner;
+    aio_slots[slot].mbox = req->mbox;
+    aio_slots[slot].cookie = req->cookie;
+
+    switch (req->dev) {
+        case AIO_DEV_BLOCK:
+            if (req->len == 0 || req->len % BLOCK_SIZE != 0) {
+                aio_slots[slot].in_use = 0;
+                mbox_unreserve(mbox_num);
+                return -1;
+            }
+            rc = kbcache_submit(req->op == AIO_READ ? BLK_OP_READ : BLK_OP_WRITE,
+                                req->offset, req->len / BLOCK_SIZE, req->buf,
+                                kaio_blk_done, slot);
+            if (rc != 0) {
+                aio_slots[slot].in_use = 0;
+                mbox_unreserve(mbox_num);
+                return -1;
+            }
+            break;
+
+        case AIO_DEV_FILE:
+            if (req->op == AIO_READ) {
+                rc = kfs_pread(req->fd, req->buf, req->len, req->offset);
+            } else {
+                rc = kfs_pwrite(req->fd, req->buf, req->len, req->offset);
+            }
+            kaio_complete(slot, rc < 0 ? -1 : 0, rc < 0 ? 0 : rc);
+            break;
+
+        default:
+            aio_slots[slot].in_use = 0;
+            mbox_unreserve(mbox_num);
+            return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Asynchronous I/O
+ */
+#ifndef KAIO_H
+#define KAIO_H
+
+#include "kbcache.h"
+
+// Asynchronous operations that may be outstanding at once
+#define AIO_MAX BCACHE_ASYNC_MAX
+
+// Devices
+#define AIO_DEV_BLOCK 0         // disk, through the buffer cache
+#define AIO_DEV_FILE 1          // in-memory file system
+
+// Operations
+#define AIO_READ 0
+#define AIO_WRITE 1
+
+// Asynchronous operation, as passed to aio_submit()
+typedef struct aio_req_t {
+    int dev;                        // AIO_DEV_BLOCK or AIO_DEV_FILE
+    int op;                         // AIO_READ or AIO_WRITE
+    int fd;                         // File handle (AIO_DEV_FILE)
+    int offset;                     // First block, or byte offset in the file
+    void *buf;                      // Data; must stay valid until completion
+    int len;                        // Bytes (a multiple of BLOCK_SIZE for blocks)
+    int mbox;                       // Mailbox the completion is posted to
+    int cookie;                     // Returned as is in the completion
+} aio_req_t;
+
+// Data of a completion message (sender MSG_SENDER_AIO)
+typedef struct aio_completion_t {
+    int cookie;                     // Cookie of the request
+    int status;                     // 0 on success, -1 on error
+    int bytes;                      // Bytes transferred
+} aio_completion_t;
+
+// Outstanding operation
+typedef struct aio_slot_t {
+    int in_use;
+    int owner;                      // Submitting process
+    int mbox;                       // Mailbox handle for the completion
+    int cookie;
+} aio_slot_t;
+
+/**
+ * Function declarations
+ */
+void kaio_init();
+void kaio_reclaim(int pid);
+int kaio_submit(aio_req_t *req, int owner);
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * ATA Disk Driver (primary master, PIO)
+ *
+ * Requests are queued and run one at a time. The drive interrupts once per
+ * sector; the IRQ 14 handler only reads the status (which acknowledges the
+ * interrupt) and the deferred work moves the sector data and completes the
+ * request.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kata.h"
+#include "kirq.h"
+#include "kwork.h"
+
+// Sectors on the drive, 0 if there is none
+static unsigned int ata_sectors;
+
+// Request on the drive and the ones waiting for it
+static ata_req_t *ata_current;
+static ata_req_t *ata_head;
+static ata_req_t *ata_tail;
+
+// Status read by the IRQ handler
+static volatile unsigned char ata_status;
+static volatile int ata_pending;
+
+static int ata_work;
+
+// Write starts still to fail on purpose, and whether the next one fails
+static int ata_fail_writes;
+static int ata_fail_next;
+
+static void kata_start();
+
+/**
+ * Waits for the drive to finish a command
+ * @return the final status, or ATA_SR_ERR if the drive never became ready
+ */
+static unsigned char kata_wait() {
+    unsigned char status;
+    int i;
+
+    for (i = 0; i < ATA_POLL_MAX; i++) {
+        status = inportb(ATA_BASE + ATA_STATUS);
+        if (!(status & ATA_SR_BSY)) {
+            return status;
+        }
+    }
+
+    return ATA_SR_ERR;
+}
+
+/**
+ * Identifies the master drive on the primary channel and registers the
+ * IRQ if one is present
+ */
+void kata_init() {
+    unsigned short id[ATA_SECTOR_SIZE / 2];
+    unsigned char status;
+    int i;
+
+    ata_sectors = 0;
+    ata_current = NULL;
+    ata_head = NULL;
+    ata_tail = NULL;
+    ata_pending = 0;
+    ata_fail_writes = 0;
+    ata_fail_next = 0;
+
+    // Identify with the interrupt disabled
+    outportb(ATA_CTRL, ATA_CTRL_NIEN);
+    outportb(ATA_BASE + ATA_DRIVE, ATA_DRIVE_LBA);
+    outportb(ATA_BASE + ATA_COUNT, 0);
+    outportb(ATA_BASE + ATA_LBA_LO, 0);
+    outportb(ATA_BASE + ATA_LBA_MID, 0);
+    outportb(ATA_BASE + ATA_LBA_HI, 0);
+    outportb(ATA_BASE + ATA_COMMAND, ATA_CMD_IDENTIFY);
+
+    status = inportb(ATA_BASE + ATA_STATUS);
+    if (status == 0 || status == 0xFF) {
+        cons_printf("ata: no drive\n");
+        return;
+    }
+
+    status = kata_wait();
+
+    // ATAPI and SATA devices report a signature instead of identifying
+    if (inportb(ATA_BASE + ATA_LBA_MID) != 0 || inportb(ATA_BASE + ATA_LBA_HI) != 0) {
+        cons_printf("ata: not an ATA drive\n");
+        return;
+    }
+
+    for (i = 0; i < ATA_POLL_MAX && !(status & (ATA_SR_DRQ | ATA_SR_ERR)); i++) {
+        status = inportb(ATA_BASE + ATA_STATUS);
+    }
+    if (!(status & ATA_SR_DRQ)) {
+        cons_printf("ata: identify failed\n");
+        return;
+    }
+
+    for (i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+        id[i] = inportw(ATA_BASE + ATA_DATA);
+    }
+
+    // Words 60-61 hold the number of LBA28 sectors
+    ata_sectors = id[60] | ((unsigned int)id[61] << 16);
+    cons_printf("ata: %u sectors\n", ata_sectors);
+
+    ata_work = kwork_register("ata", kata_work);
+
+    if (kirq_register(IRQ_ATA_PRIMARY, "ata", kata_irq) != 0) {
+        panic("Unable to register the ATA IRQ");
+    }
+    outportb(ATA_CTRL, 0);
+}
+
+/**
+ * Returns the size of the drive
+ * @return number of sectors, 0 if there is no drive
+ */
+unsigned int kata_sectors() {
+    return ata_sectors;
+}
+
+/**
+ * Writes the next sector of the current request to the drive
+ */
+static void kata_put_sector() {
+    unsigned short *data = (unsigned short *)ata_current->buf[ata_current->done];
+    int i;
+
+    for (i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+        outportw(ATA_BASE + ATA_DATA, data[i]);
+    }
+}
+
+/**
+ * Finishes the current request and starts the next one
+ * @param  status - 0 on success, -1 on error
+ */
+static void kata_finish(int status) {
+    ata_req_t *req = ata_current;
+
+    ata_current = NULL;
+    req->status = status;
+    req->complete(req);
+
+    kata_start();
+}
+
+/**
+ * Issues the first queued request to the drive
+ */
+static void kata_start() {
+    unsigned char status;
+    ata_req_t *req;
+
+    if (ata_current != NULL || ata_head == NULL) {
+        return;
+    }
+
+    req = ata_head;
+    ata_head = req->next;
+    if (ata_head == NULL) {
+        ata_tail = NULL;
+    }
+    ata_current = req;
+
+    if (req->op == ATA_WRITE && ata_fail_writes > 0) {
+        ata_fail_next = !ata_fail_next;
+        if (ata_fail_next) {
+            ata_fail_writes--;
+            kata_finish(-1);
+            return;
+        }
+    }
+
+    kata_wait();
+    outportb(ATA_BASE + ATA_DRIVE, ATA_DRIVE_LBA | ((req->lba >> 24) & 0x0F));
+    outportb(ATA_BASE + ATA_COUNT, req->count);
+    outportb(ATA_BASE + ATA_LBA_LO, req->lba & 0xFF);
+    outportb(ATA_BASE + ATA_LBA_MID, (req->lba >> 8) & 0xFF);
+    outportb(ATA_BASE + ATA_LBA_HI, (req->lba >> 16) & 0xFF);
+    outportb(ATA_BASE + ATA_COMMAND, req->op == ATA_WRITE ? ATA_CMD_WRITE : ATA_CMD_READ);
+
+    // Writes supply the first sector without waiting for an interrupt
+    if (req->op == ATA_WRITE) {
+        status = kata_wait();
+        if ((status & (ATA_SR_ERR | ATA_SR_DF)) || !(status & ATA_SR_DRQ)) {
+            kata_finish(-1);
+            return;
+        }
+        kata_put_sector();
+    }
+}
+
+/**
+ * Queues a block request
+ * @param  req - request to run; must stay valid until completed
+ * @return 0 on success, -1 if the request is invalid
+ */
+int kata_submit(ata_req_t *req) {
+    if (req == NULL || req->complete == NULL) {
+        panic("NULL POINTER");
+    }
+
+    if (ata_sectors == 0 || req->count < 1 || req->count > ATA_MULTI_MAX ||
+        req->lba >= ata_sectors || (unsigned int)req->count > ata_sectors - req->lba) {
+        return -1;
+    }
+
+    req->status = 0;
+    req->done = 0;
+    req->next = NULL;
+
+    if (ata_tail == NULL) {
+        ata_head = req;
+    } else {
+        ata_tail->next = req;
+    }
+    ata_tail = req;
+
+    kata_start();
+    return 0;
+}
+
+/**
+ * Makes every other write fail to start, as a drive that refuses the
+ * command would, until count writes have failed (for testing)
+ * @param  count - number of writes to fail, 0 to stop
+ */
+void kata_fail_writes(int count) {
+    ata_fail_writes = count;
+    ata_fail_next = 0;
+}
+
+/**
+ * IRQ 14 handler: acknowledges the drive
+ * @param  irq - IRQ line (IRQ_ATA_PRIMARY)
+ */
+void kata_irq(int irq) {
+    ata_status = inportb(ATA_BASE + ATA_STATUS);
+    ata_pending = 1;
+    kwork_raise(ata_work);
+}
+
+/**
+ * ATA deferred work: moves the sector the drive interrupted for
+ */
+void kata_work() {
+    unsigned short *data;
+    int i;
+
+    if (!ata_pending || ata_current == NULL) {
+        return;
+    }
+    ata_pending = 0;
+
+    if (ata_status & (ATA_SR_ERR | ATA_SR_DF)) {
+        kata_finish(-1);
+        return;
+    }
+
+    if (ata_current->op == ATA_READ) {
+        data = (unsigned short *)ata_current->buf[ata_current->done];
+        for (i = 0; i < ATA_SECTOR_SIZE / 2; i++) {
+            data[i] = inportw(ATA_BASE + ATA_DATA);
+        }
+        ata_current->done++;
+    } else {
+        ata_current->done++;
+        if (ata_current->done < ata_current->count) {
+            kata_put_sector();
+        }
+    }
+
+    if (ata_current->done == ata_current->count) {
+        kata_finish(0);
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * ATA Disk Driver (primary master, PIO)
+ */
+#ifndef KATA_H
+#define KATA_H
+
+// Primary channel ports
+#define ATA_BASE 0x1F0
+#define ATA_CTRL 0x3F6
+
+// Registers (offsets from ATA_BASE)
+#define ATA_DATA 0
+#define ATA_ERROR 1
+#define ATA_COUNT 2
+#define ATA_LBA_LO 3
+#define ATA_LBA_MID 4
+#define ATA_LBA_HI 5
+#define ATA_DRIVE 6
+#define ATA_STATUS 7        // read
+#define ATA_COMMAND 7       // write
+
+// Status bits
+#define ATA_SR_BSY 0x80
+#define ATA_SR_DRDY 0x40
+#define ATA_SR_DF 0x20
+#define ATA_SR_DRQ 0x08
+#define ATA_SR_ERR 0x01
+
+// Commands
+#define ATA_CMD_READ 0x20
+#define ATA_CMD_WRITE 0x30
+#define ATA_CMD_IDENTIFY 0xEC
+
+// Drive select for the master in LBA mode (LBA bits 24-27 are or-ed in)
+#define ATA_DRIVE_LBA 0xE0
+
+// Device control: nIEN disables the interrupt
+#define ATA_CTRL_NIEN 0x02
+
+#define ATA_SECTOR_SIZE 512
+
+// Most sectors a single request transfers
+#define ATA_MULTI_MAX 8
+
+// Status polls before giving up on the drive
+#define ATA_POLL_MAX 100000
+
+// Request operations
+#define ATA_READ 0
+#define ATA_WRITE 1
+
+// Block request; the driver calls complete() from deferred work once the
+// transfer finishes or fails
+typedef struct ata_req_t {
+    int op;                         // ATA_READ or ATA_WRITE
+    unsigned int lba;               // First sector
+    int count;                      // Sectors to transfer (1 to ATA_MULTI_MAX)
+    char *buf[ATA_MULTI_MAX];       // One ATA_SECTOR_SIZE buffer per sector
+    int status;                     // 0 on success, -1 on error
+    int done;                       // Sectors transferred so far
+    void (*complete)(struct ata_req_t *req);
+    struct ata_req_t *next;         // Next request waiting for the drive
+} ata_req_t;
+
+/**
+ * Function declarations
+ */
+void kata_init();
+unsigned int kata_sectors();
+int kata_submit(ata_req_t *req);
+void kata_fail_writes(int count);
+void kata_irq(int irq);
+void kata_work();
+
+#endif
@@ -0,0 +1,490 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Block Buffer Cache
+ *
+ * Blocks are kept in a small LRU cache on top of the ATA driver. A read
+ * miss also reads ahead the following blocks in the same request. Writes
+ * only dirty the cached block; dirty blocks go to disk when they are
+ * evicted, when too many pile up, or on blk_sync().
+ *
+ * An operation that has to wait for the disk is parked and retried each
+ * time a transfer completes. Blocking system calls then wake their
+ * process; asynchronous requests call their completion function.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kbcache.h"
+#include "queue.h"
+#include "string.h"
+
+static buf_t bufs[BCACHE_BUFS];
+static bio_t bios[BCACHE_BUFS];
+// Blocking requests of each process, then the asynchronous ones
+static blk_req_t blk_reqs[BCACHE_REQS];
+
+// Use counter for LRU replacement and number of dirty blocks
+static unsigned int bcache_clock;
+static int bcache_dirty;
+
+/**
+ * Initializes the buffer cache
+ */
+void kbcache_init() {
+    int i;
+
+    sp_memset(bufs, 0, sizeof(bufs));
+    sp_memset(bios, 0, sizeof(bios));
+    sp_memset(blk_reqs, 0, sizeof(blk_reqs));
+
+    for (i = 0; i < BCACHE_BUFS; i++) {
+        bufs[i].lba = -1;
+    }
+
+    bcache_clock = 0;
+    bcache_dirty = 0;
+}
+
+/**
+ * Finds the buffer holding a block
+ * @param  lba - block number
+ * @return buffer index, -1 if the block is not cached
+ */
+static int bcache_find(int lba) {
+    int i;
+
+    for (i = 0; i < BCACHE_BUFS; i++) {
+        if (bufs[i].lba == lba) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Marks a buffer as the most recently used
+ * @param  b - buffer index
+ */
+static void bcache_touch(int b) {
+    bufs[b].used = ++bcache_clock;
+}
+
+/**
+ * Takes a free transfer descriptor
+ * @return the descriptor, NULL if all are in use
+ */
+static bio_t *bio_alloc() {
+    int i;
+
+    for (i = 0; i < BCACHE_BUFS; i++) {
+        if (!bios[i].in_use) {
+            sp_memset(&bios[i], 0, sizeof(bio_t));
+            bios[i].in_use = 1;
+            return &bios[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void bcache_done(ata_req_t *req);
+
+/**
+ * Submits a transfer, failing its buffers if the driver rejects it
+ * @param  bio - transfer with its buffers marked B_BUSY
+ * @param  op  - ATA_READ or ATA_WRITE
+ */
+static void bio_submit(bio_t *bio, int op) {
+    bio->req.op = op;
+    bio->req.complete = bcache_done;
+
+    if (kata_submit(&bio->req) != 0) {
+        bio->req.status = -1;
+        bcache_done(&bio->req);
+    }
+}
+
+/**
+ * Starts writing a dirty buffer back to disk
+ * @param  b - buffer index
+ * @return 0 if the write was started, -1 if no descriptor is free
+ */
+static int bcache_writeback(int b) {
+    bio_t *bio = bio_alloc();
+
+    if (bio == NULL) {
+        return -1;
+    }
+
+    bufs[b].flags |= B_BUSY;
+    bio->bufs[0] = b;
+    bio->req.lba = bufs[b].lba;
+    bio->req.count = 1;
+    bio->req.buf[0] = bufs[b].data;
+    bio_submit(bio, ATA_WRITE);
+
+    return 0;
+}
+
+/**
+ * Starts writing back the least recently used dirty buffer
+ */
+static void bcache_writeback_oldest() {
+    int victim = -1;
+    int i;
+
+    for (i = 0; i < BCACHE_BUFS; i++) {
+        if ((bufs[i].flags & (B_DIRTY | B_BUSY)) == B_DIRTY &&
+            (victim < 0 || bufs[i].used < bufs[victim].used)) {
+            victim = i;
+        }
+    }
+
+    if (victim >= 0) {
+        bcache_writeback(victim);
+    }
+}
+
+/**
+ * Takes the least recently used clean buffer for a block
+ * @param  lba - block the buffer will hold
+ * @return buffer index, -1 if every buffer is dirty or busy
+ */
+static int bcache_alloc(int lba) {
+    int victim = -1;
+    int i;
+
+    for (i = 0; i < BCACHE_BUFS; i++) {
+        if (!(bufs[i].flags & (B_DIRTY | B_BUSY)) &&
+            (victim < 0 || bufs[i].used < bufs[victim].used)) {
+            victim = i;
+        }
+    }
+
+    if (victim < 0) {
+        // Make room for the next attempt
+        bcache_writeback_oldest();
+        return -1;
+    }
+
+    bufs[victim].lba = lba;
+    bufs[victim].flags = 0;
+    bcache_touch(victim);
+    return victim;
+}
+
+/**
+ * Reads a block into the cache along with the blocks following it
+ * The block that missed is always the first of the transfer.
+ * @param  lba - block that missed
+ */
+static void bcache_fill(int lba) {
+    bio_t *bio;
+    int b;
+
+    bio = bio_alloc();
+    if (bio == NULL) {
+        return;
+    }
+
+    b = bcache_alloc(lba);
+    if (b < 0) {
+        bio->in_use = 0;
+        return;
+    }
+
+    bio->req.lba = lba;
+    do {
+        bufs[b].flags = B_BUSY;
+        bio->bufs[bio->req.count] = b;
+        bio->req.buf[bio->req.count] = bufs[b].data;
+        bio->req.count++;
+
+        lba++;
+        if (bio->req.count > BCACHE_READAHEAD || (unsigned int)lba >= kata_sectors() ||
+            bcache_find(lba) >= 0) {
+            break;
+        }
+        b = bcache_alloc(lba);
+    } while (b >= 0);
+
+    bio_submit(bio, ATA_READ);
+}
+
+/**
+ * Transfers one block of a request through the cache
+ * @param  req - request whose next block to transfer
+ * @return 1 if the block was transferred or failed (req->status is set),
+ *         0 if it has to wait for the disk
+ */
+static int bcache_block(blk_req_t *req) {
+    char *data = req->buf + req->done * BLOCK_SIZE;
+    int lba = req->lba + req->done;
+    int b;
+
+    if (lba < 0 || (unsigned int)lba >= kata_sectors()) {
+        req->status = -1;
+        return 1;
+    }
+
+    b = bcache_find(lba);
+    if (b >= 0 && (bufs[b].flags & B_BUSY)) {
+        return 0;
+    }
+
+    if (req->op == BLK_OP_READ) {
+        if (b < 0) {
+            bcache_fill(lba);
+
+            // The read may already have failed
+            b = bcache_find(lba);
+            if (b < 0 || (bufs[b].flags & B_BUSY)) {
+                return 0;
+            }
+        }
+
+        if (bufs[b].flags & B_ERROR) {
+            // Report the failure once; the next read tries the disk again
+            bufs[b].lba = -1;
+            bufs[b].flags = 0;
+            req->status = -1;
+            return 1;
+        }
+
+        sp_memcpy(data, bufs[b].data, BLOCK_SIZE);
+    } else {
+        if (b < 0) {
+            b = bcache_alloc(lba);
+            if (b < 0) {
+                return 0;
+            }
+        }
+
+        sp_memcpy(bufs[b].data, data, BLOCK_SIZE);
+        if (!(bufs[b].flags & B_DIRTY)) {
+            bcache_dirty++;
+        }
+        bufs[b].flags = B_VALID | B_DIRTY;
+
+        if (bcache_dirty > BCACHE_DIRTY_MAX) {
+            bcache_writeback_oldest();
+        }
+    }
+
+    bcache_touch(b);
+    return 1;
+}
+
+/**
+ * Runs a block operation as far as it can go without waiting
+ * @param  req - request to run
+ * @return 1 if the operation finished (the result is in req->status), 0 if
+ *         it has to wait for the disk
+ */
+static int bcache_op(blk_req_t *req) {
+    int dirty = 0;
+    int i;
+
+    if (req->op == BLK_OP_SYNC) {
+        for (i = 0; i < BCACHE_BUFS; i++) {
+            if ((bufs[i].flags & (B_DIRTY | B_BUSY)) == B_DIRTY) {
+                bcache_writeback(i);
+            }
+            if (bufs[i].flags & B_DIRTY) {
+                dirty = 1;
+            }
+        }
+        return !dirty;
+    }
+
+    while (req->done < req->count) {
+        if (!bcache_block(req)) {
+            return 0;
+        }
+        if (req->status != 0) {
+            return 1;
+        }
+        req->done++;
+    }
+
+    return 1;
+}
+
+/**
+ * Completion of a transfer: updates its buffers and retries the waiting
+ * operations
+ * @param  req - finished driver request (the first member of a bio_t)
+ */
+static void bcache_done(ata_req_t *req) {
+    bio_t *bio = (bio_t *)req;
+    blk_req_t *waiter;
+    int b;
+    int i;
+
+    for (i = 0; i < req->count; i++) {
+        b = bio->bufs[i];
+        bufs[b].flags &= ~B_BUSY;
+
+        if (req->op == ATA_READ) {
+            if (req->status == 0) {
+                bufs[b].flags |= B_VALID;
+            } else if (i == 0) {
+                // Only the block that missed reports the error
+                bufs[b].flags |= B_ERROR;
+            } else {
+                // Nobody asked for the read-ahead blocks: drop them so
+                // they are read again on their own when needed
+                bufs[b].lba = -1;
+                bufs[b].flags = 0;
+            }
+        } else {
+            // A failed write is dropped rather than retried forever
+            if (req->status != 0) {
+                cons_printf("bcache: write of block %d failed\n", bufs[b].lba);
+            }
+            bufs[b].flags &= ~B_DIRTY;
+            bcache_dirty--;
+        }
+    }
+    bio->in_use = 0;
+
+    // A retry can start a write that fails at once and re-enters here, so
+    // the waiter is unmarked while it runs and the nested call skips it
+    for (i = 0; i < BCACHE_REQS; i++) {
+        waiter = &blk_reqs[i];
+
+        if (!waiter->in_use || !waiter->waiting) {
+            continue;
+        }
+
+        waiter->waiting = 0;
+        if (!bcache_op(waiter)) {
+            waiter->waiting = 1;
+            continue;
+        }
+
+        waiter->in_use = 0;
+        waiter->complete(waiter);
+    }
+}
+
+/**
+ * Completion of a blocking system call: returns the status to the process
+ * and makes it ready
+ * @param  req - finished request of the process
+ */
+static void bcache_wake(blk_req_t *req) {
+    if (pcb[req->owner].state != WAITING) {
+        panic("BLOCK WAITER WOKEN TWICE");
+    }
+
+    pcb[req->owner].trapframe_p->ebx = req->status;
+    pcb[req->owner].state = READY;
+    if (enqueue(pcb[req->owner].queue, req->owner) != 0) {
+        panic("CAN'T ENQUEUE BLOCK WAITER TO RUN QUEUE");
+    }
+}
+
+/**
+ * Runs a block operation for a process, which waits for it if it needs
+ * the disk
+ * @param  pid - process
+ * @param  op  - operation to run
+ * @param  lba - block to read or write (unused for BLK_OP_SYNC)
+ * @param  buf - one block of data (unused for BLK_OP_SYNC)
+ * @return 0 on success, -1 on error, KSYSCALL_BLOCKED if the process has
+ *         to wait for the disk
+ */
+int kbcache_rw(int pid, blk_op_e op, int lba, char *buf) {
+    blk_req_t *req = &blk_reqs[pid];
+
+    sp_memset(req, 0, sizeof(blk_req_t));
+    req->in_use = 1;
+    req->op = op;
+    req->lba = lba;
+    req->count = 1;
+    req->buf = buf;
+    req->owner = pid;
+    req->complete = bcache_wake;
+
+    if (bcache_op(req)) {
+        req->in_use = 0;
+        return req->status;
+    }
+
+    req->waiting = 1;
+    return KSYSCALL_BLOCKED;
+}
+
+/**
+ * Starts an asynchronous block operation for the running process
+ * @param  op       - BLK_OP_READ or BLK_OP_WRITE
+ * @param  lba      - first block
+ * @param  count    - number of blocks
+ * @param  buf      - data, count * BLOCK_SIZE bytes
+ * @param  complete - called once the operation finishes, possibly before
+ *                    this returns
+ * @param  arg      - value stored in the request for complete()
+ * @return 0 if the operation was started, -1 if it is invalid or too many
+ *         are outstanding
+ */
+int kbcache_submit(blk_op_e op, int lba, int count, char *buf,
+                   void (*complete)(blk_req_t *req), int arg) {
+    blk_req_t *req = NULL;
+    int i;
+
+    if (buf == NULL || complete == NULL) {
+        panic("NULL POINTER");
+    }
+    if (op == BLK_OP_SYNC || count <= 0 || kata_sectors() == 0) {
+        return -1;
+    }
+
+    for (i = PROC_MAX; i < BCACHE_REQS; i++) {
+        if (!blk_reqs[i].in_use) {
+            req = &blk_reqs[i];
+            break;
+        }
+    }
+    if (req == NULL) {
+        return -1;
+    }
+
+    sp_memset(req, 0, sizeof(blk_req_t));
+    req->in_use = 1;
+    req->op = op;
+    req->lba = lba;
+    req->count = count;
+    req->buf = buf;
+    req->owner = run_pid;
+    req->arg = arg;
+    req->complete = complete;
+
+    if (bcache_op(req)) {
+        req->in_use = 0;
+        complete(req);
+    } else {
+        req->waiting = 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Drops the asynchronous operations of an exiting process; transfers
+ * already on the disk finish without touching its memory
+ * @param  pid - exiting process
+ */
+void kbcache_reclaim(int pid) {
+    int i;
+
+    for (i = PROC_MAX; i < BCACHE_REQS; i++) {
+        if (blk_reqs[i].in_use && blk_reqs[i].owner == pid) {
+            blk_reqs[i].in_use = 0;
+            blk_reqs[i].waiting = 0;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Block Buffer Cache
+ */
+#ifndef KBCACHE_H
+#define KBCACHE_H
+
+#include "global.h"
+#include "kata.h"
+
+// Size of a block (one disk sector)
+#define BLOCK_SIZE ATA_SECTOR_SIZE
+
+// Number of cached blocks
+#define BCACHE_BUFS 32
+
+// Blocks read ahead after a miss (at most ATA_MULTI_MAX-1)
+#define BCACHE_READAHEAD 4
+
+// Dirty blocks allowed before write-back starts on its own
+#define BCACHE_DIRTY_MAX (BCACHE_BUFS / 2)
+
+// Buffer flags
+#define B_VALID 0x1         // holds the block's data
+#define B_DIRTY 0x2         // modified since it was read or written
+#define B_BUSY 0x4          // disk transfer in progress
+#define B_ERROR 0x8         // the last read failed
+
+// Cached block
+typedef struct buf_t {
+    int lba;                        // Block number, -1 if unused
+    int flags;                      // B_* flags
+    unsigned int used;              // Last use, for LRU replacement
+    char data[BLOCK_SIZE];
+} buf_t;
+
+// Disk transfer of one or more cached blocks
+typedef struct bio_t {
+    ata_req_t req;                  // Driver request (must be first)
+    int bufs[ATA_MULTI_MAX];        // Buffer of each sector
+    int in_use;
+} bio_t;
+
+// Block operations of waiting processes
+typedef enum {
+    BLK_OP_READ,
+    BLK_OP_WRITE,
+    BLK_OP_SYNC
+} blk_op_e;
+
+// Asynchronous block requests that may be outstanding at once
+#define BCACHE_ASYNC_MAX 16
+#define BCACHE_REQS (PROC_MAX + BCACHE_ASYNC_MAX)
+
+// Block operation, kept while it waits for the disk. Each process has one
+// for its blocking system calls; asynchronous requests take one of the rest.
+typedef struct blk_req_t {
+    int in_use;
+    int waiting;                    // Set while parked until a transfer completes
+    blk_op_e op;
+    int lba;                        // First block
+    int count;                      // Blocks to transfer
+    int done;                       // Blocks transferred so far
+    char *buf;                      // Caller's data (count * BLOCK_SIZE bytes)
+    int status;                     // 0 on success, -1 on error
+    int owner;                      // Process that made the request
+    int arg;                        // Value for complete()
+    void (*complete)(struct blk_req_t *req);
+} blk_req_t;
+
+/**
+ * Function declarations
+ */
+void kbcache_init();
+int kbcache_submit(blk_op_e op, int lba, int count, char *buf,
+                   void (*complete)(blk_req_t *req), int arg);
+void kbcache_reclaim(int pid);
+int kbcache_rw(int pid, blk_op_e op, int lba, char *buf);
+
+#endif
@@ -0,0 +1,314 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * High Resolution Clock
+ *
+ * Time is read from the CPU time stamp counter, whose rate is measured
+ * at boot against PIT channel 2. If the measurement fails the clock falls
+ * back to counting timer ticks.
+ *
+ * PIT channel 0 drives the timer interrupt at tick_hz, which may be
+ * changed at run time.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kclock.h"
+#include "queue.h"
+#include "kwork.h"
+#include "ktrace.h"
+
+// TSC rate in cycles per millisecond, 0 if not calibrated
+static unsigned int tsc_khz;
+
+// TSC value at boot (time 0)
+static unsigned long long tsc_base;
+
+// Timer interrupt frequency (Hz)
+static int tick_hz = CLK_TCK;
+
+// Time counted in timer ticks, used when the TSC is not calibrated
+static unsigned long long tick_clock_ns;
+
+// Length of a timer tick as programmed into the PIT: whole nanoseconds,
+// plus a remainder in 1/PIT_HZ nanosecond units carried in tick_frac
+static unsigned int tick_period_ns = NSEC_PER_SEC / CLK_TCK;
+static unsigned int tick_period_rem;
+static unsigned int tick_frac;
+
+// Timer ticks in a scheduling quantum at the current frequency
+int proc_ticks_max = PROC_QUANTUM_MS * CLK_TCK / 1000;
+
+/**
+ * Reads the time stamp counter
+ * @return the current cycle count
+ */
+unsigned long long kclock_cycles() {
+    unsigned int lo;
+    unsigned int hi;
+
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+}
+
+/**
+ * Divides a 64-bit value by a 32-bit value in place
+ * (the kernel is not linked against libgcc's 64-bit division)
+ * @param  n    - dividend; replaced by the quotient
+ * @param  base - divisor
+ * @return the remainder
+ */
+unsigned int kclock_div(unsigned long long *n, unsigned int base) {
+    unsigned int high = (unsigned int)(*n >> 32);
+    unsigned int low = (unsigned int)*n;
+    unsigned int q_high = 0;
+    unsigned int rem;
+
+    if (high >= base) {
+        q_high = high / base;
+        high %= base;
+    }
+
+    asm("divl %4"
+        : "=a" (low), "=d" (rem)
+        : "0" (low), "1" (high), "rm" (base));
+
+    *n = ((unsigned long long)q_high << 32) | low;
+    return rem;
+}
+
+/**
+ * Calibrates the TSC against a one-shot count of PIT channel 2
+ * Must run before interrupts are enabled.
+ */
+void kclock_init() {
+    unsigned int count = PIT_HZ / (1000 / KCLOCK_CAL_MS);
+    unsigned long long start;
+    unsigned long long cycles;
+    int loops = 0;
+
+    // Enable the channel 2 gate with the speaker output off
+    outportb(0x61, (inportb(0x61) & ~0x02) | 0x01);
+
+    // Channel 2, lobyte/hibyte access, mode 0 (interrupt on terminal count)
+    outportb(0x43, 0xB0);
+    outportb(0x42, count & 0xff);
+    outportb(0x42, (count >> 8) & 0xff);
+
+    start = kclock_cycles();
+
+    // OUT2 goes high once the count reaches zero
+    while ((inportb(0x61) & 0x20) == 0) {
+        if (++loops > IO_DELAY_LOOP) {
+            break;
+        }
+    }
+
+    cycles = kclock_cycles() - start;
+    tsc_base = kclock_cycles();
+
+    if (loops > IO_DELAY_LOOP) {
+        tsc_khz = 0;
+    } else {
+        kclock_div(&cycles, KCLOCK_CAL_MS);
+        tsc_khz = (unsigned int)cycles;
+    }
+
+    if (kclock_set_hz(TICK_HZ) != 0) {
+        kclock_set_hz(CLK_TCK);
+    }
+}
+
+/**
+ * Reprograms PIT channel 0 to interrupt at the given frequency and
+ * rescales the scheduling quantum to match
+ * @param  hz - timer interrupts per second
+ * @return 0 on success, -1 if hz is out of range
+ */
+int kclock_set_hz(int hz) {
+    unsigned long long period;
+    int divisor;
+
+    if (hz < TICK_HZ_MIN || hz > TICK_HZ_MAX) {
+        return -1;
+    }
+
+    divisor = (PIT_HZ + hz / 2) / hz;
+
+    // Channel 0, lobyte/hibyte access, mode 2 (rate generator); the
+    // kernel runs with interrupts disabled so no tick can land in between
+    outportb(0x43, 0x34);
+    outportb(0x40, divisor & 0xff);
+    outportb(0x40, (divisor >> 8) & 0xff);
+    tick_hz = hz;
+
+    // The PIT runs at PIT_HZ / divisor, which is rarely exactly hz
+    period = (unsigned long long)divisor * NSEC_PER_SEC;
+    tick_period_rem = kclock_div(&period, PIT_HZ);
+    tick_period_ns = (unsigned int)period;
+
+    proc_ticks_max = PROC_QUANTUM_MS * hz / 1000;
+    if (proc_ticks_max < 1) {
+        proc_ticks_max = 1;
+    }
+    return 0;
+}
+
+/**
+ * Returns the timer interrupt frequency
+ * @return timer interrupts per second
+ */
+int kclock_hz() {
+    return tick_hz;
+}
+
+/**
+ * Returns the calibrated TSC frequency
+ * @return TSC cycles per millisecond, 0 if calibration failed
+ */
+unsigned int kclock_khz() {
+    return tsc_khz;
+}
+
+/**
+ * Advances the tick counters; called on every timer interrupt
+ */
+void kclock_tick() {
+    system_time++;
+    tick_clock_ns += tick_period_ns;
+
+    tick_frac += tick_period_rem;
+    if (tick_frac >= PIT_HZ) {
+        tick_frac -= PIT_HZ;
+        tick_clock_ns++;
+    }
+}
+
+/**
+ * Returns the time since boot
+ * @return nanoseconds since kclock_init()
+ */
+unsigned long long kclock_ns() {
+    unsigned long long ns;
+    int flags;
+
+    if (tsc_khz == 0) {
+        // The tick count is 64 bits wide; don't let a tick split the read
+        flags = irq_save();
+        ns = tick_clock_ns;
+        irq_restore(flags);
+        return ns;
+    }
+
+    return kclock_cycles_to_ns(kclock_cycles() - tsc_base);
+}
+
+/**
+ * Converts a number of TSC cycles to nanoseconds
+ * @param  cycles - cycle count
+ * @return nanoseconds; 0 if the TSC is not calibrated
+ */
+unsigned long long kclock_cycles_to_ns(unsigned long long cycles) {
+    unsigned long long ns;
+    unsigned int rem;
+
+    if (tsc_khz == 0) {
+        return 0;
+    }
+
+    // Whole milliseconds, then the fraction of the last one
+    rem = kclock_div(&cycles, tsc_khz);
+
+    ns = (unsigned long long)rem * NSEC_PER_MSEC;
+    kclock_div(&ns, tsc_khz);
+
+    return cycles * NSEC_PER_MSEC + ns;
+}
+
+/**
+ * Returns the time since boot as seconds and nanoseconds
+ * @param  ts - destination
+ */
+void kclock_gettime(timespec_t *ts) {
+    unsigned long long ns = kclock_ns();
+
+    ts->tv_nsec = kclock_div(&ns, NSEC_PER_SEC);
+    ts->tv_sec = (int)ns;
+}
+
+/**
+ * Puts a process on the sleep queue, which is kept sorted by wake time
+ * If another sleeper is due to wake within the process' timer slack after
+ * wake_ns, the process wakes along with it instead, so both are handled by
+ * the same timer interrupt.
+ * @param  pid     - process to put to sleep
+ * @param  wake_ns - time (kclock_ns) at which to wake it
+ */
+void kclock_sleep(int pid, unsigned long long wake_ns) {
+    unsigned long long latest = wake_ns + pcb[pid].timer_slack_ns;
+    int size = sleep_q.size;
+    int inserted = 0;
+    int item;
+    int i;
+
+    // Share the first wakeup that falls within the slack window
+    for (i = 0; i < sleep_q.size; i++) {
+        item = sleep_q.items[(sleep_q.head + i) % QUEUE_SIZE];
+        if (pcb[item].wake_ns >= wake_ns) {
+            if (pcb[item].wake_ns <= latest) {
+                wake_ns = pcb[item].wake_ns;
+            }
+            break;
+        }
+    }
+
+    pcb[pid].wake_ns = wake_ns;
+
+    // Rotate the queue once, slotting the new entry in ahead of the
+    // first process that wakes later
+    while (size--) {
+        if (dequeue(&sleep_q, &item) != 0) {
+            panic("Error retrieving process from sleep queue");
+        }
+        if (!inserted && pcb[item].wake_ns > wake_ns) {
+            enqueue(&sleep_q, pid);
+            inserted = 1;
+        }
+        enqueue(&sleep_q, item);
+    }
+
+    if (!inserted && enqueue(&sleep_q, pid) != 0) {
+        panic("Error adding process to its sleep queue");
+    }
+}
+
+/**
+ * Wakes every process on the sleep queue whose wake time has passed
+ * A timed wait that expires leaves its wait queue with a -1 result.
+ */
+void kclock_expire() {
+    unsigned long long now = kclock_ns();
+    int pid;
+
+    while (sleep_q.size > 0) {
+        pid = sleep_q.items[sleep_q.head];
+
+        if (pcb[pid].wake_ns > now) {
+            break;
+        }
+
+        dequeue(&sleep_q, &pid);
+        KTRACE(TRACE_WAKE, TRACE_EV_WAKE, pid, 0);
+
+        if (pcb[pid].timeout_q != NULL) {
+            queue_remove(pcb[pid].timeout_q, pid);
+            pcb[pid].timeout_q = NULL;
+            pcb[pid].trapframe_p->ebx = -1;
+        }
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("Error adding process to its run queue");
+        }
+        pcb[pid].state = READY;
+    }
+}
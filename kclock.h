@@ -0,0 +1,55 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * High Resolution Clock
+ */
+#ifndef KCLOCK_H
+#define KCLOCK_H
+
+#include "global.h"
+
+#define NSEC_PER_SEC 1000000000
+#define NSEC_PER_MSEC 1000000
+
+// PIT input clock frequency (Hz)
+#define PIT_HZ 1193182
+
+// Length of the TSC calibration interval (ms)
+#define KCLOCK_CAL_MS 10
+
+// Timer interrupt frequency at boot (Hz); override with
+// "make EXTRA_CFLAGS=-DTICK_HZ=<hz>" to suit the deployment
+#ifndef TICK_HZ
+#define TICK_HZ CLK_TCK
+#endif
+
+// Supported timer interrupt frequencies (the PIT divisor is 16 bits)
+#define TICK_HZ_MIN 19
+#define TICK_HZ_MAX 10000
+
+// Timer slack given to new processes, and the most a process may ask for
+#define TIMER_SLACK_DEFAULT_NS 50000
+#define TIMER_SLACK_MAX_US 1000000
+
+// Timer ticks in a scheduling quantum at the current frequency
+extern int proc_ticks_max;
+
+/**
+ * Function declarations
+ */
+void kclock_init();
+int kclock_set_hz(int hz);
+int kclock_hz();
+unsigned int kclock_khz();
+void kclock_tick();
+unsigned long long kclock_ns();
+unsigned long long kclock_cycles();
+unsigned long long kclock_cycles_to_ns(unsigned long long cycles);
+void kclock_gettime(timespec_t *ts);
+unsigned int kclock_div(unsigned long long *n, unsigned int base);
+void kclock_sleep(int pid, unsigned long long wake_ns);
+void kclock_expire();
+
+#endif
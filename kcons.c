@@ -0,0 +1,177 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Console Service
+ *
+ * Processes log whole records into their own buffer with one system call
+ * and carry on; the console task writes the buffers out a record at a time
+ * to the display and COM1, so output from different processes never
+ * interleaves mid-line.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kcons.h"
+#include "queue.h"
+#include "string.h"
+#include "syscall.h"
+
+static cons_ring_t cons_rings[PROC_MAX];
+
+// Console task, and whether it is waiting for output
+static int cons_pid;
+static int cons_waiting;
+
+/**
+ * Initializes the console buffers
+ */
+void kcons_init() {
+    sp_memset(cons_rings, 0, sizeof(cons_rings));
+    cons_pid = -1;
+    cons_waiting = 0;
+}
+
+/**
+ * Checks whether any process has output pending
+ * @return 1 if there is output to write, 0 otherwise
+ */
+static int kcons_pending() {
+    int i;
+
+    for (i = 0; i < PROC_MAX; i++) {
+        if (cons_rings[i].head != cons_rings[i].tail) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Writes out up to CONS_BATCH bytes of a buffer to the display and the
+ * serial port, stopping at the end of a record
+ * @param  ring - buffer to write out
+ */
+static void kcons_drain(cons_ring_t *ring) {
+    char batch[CONS_RING_SIZE];
+    unsigned int head = ring->head;
+    unsigned int tail = ring->tail;
+    int len = 0;
+    int i;
+
+    while (tail != head) {
+        batch[len] = ring->buf[tail % CONS_RING_SIZE];
+        tail++;
+        len++;
+
+        if (batch[len - 1] == '\n' && len >= CONS_BATCH) {
+            break;
+        }
+    }
+
+    // Free the space before waiting on the serial port
+    ring->tail = tail;
+
+    for (i = 0; i < len; i++) {
+        cons_putchar(batch[i]);
+    }
+
+    if (len > 0) {
+        serial_write(batch, len, 0);
+    }
+}
+
+/**
+ * Console task: writes out buffered output, waiting while there is none
+ */
+void ktask_cons() {
+    unsigned int dropped;
+    int i;
+
+    cons_printf("cons_task started\n");
+
+    while (1) {
+        for (i = 0; i < PROC_MAX; i++) {
+            kcons_drain(&cons_rings[i]);
+
+            dropped = cons_rings[i].dropped;
+            if (dropped != cons_rings[i].reported) {
+                cons_printf("cons: pid=%02d dropped %u records\n",
+                            i, dropped - cons_rings[i].reported);
+                cons_rings[i].reported = dropped;
+            }
+        }
+
+        cons_wait();
+    }
+}
+
+/**
+ * Copies a record into a process' buffer, dropping the whole record when
+ * it does not fit, and wakes the console task
+ * @param  pid    - writing process
+ * @param  record - record to buffer
+ * @param  len    - length of the record
+ * @return number of bytes buffered, -1 if the record was dropped
+ */
+int kcons_write(int pid, char *record, unsigned int len) {
+    cons_ring_t *ring = &cons_rings[pid];
+    unsigned int i;
+
+    if (len > CONS_RECORD_MAX || len > CONS_RING_SIZE - (ring->head - ring->tail)) {
+        ring->dropped++;
+        return -1;
+    }
+
+    for (i = 0; i < len; i++) {
+        ring->buf[(ring->head + i) % CONS_RING_SIZE] = record[i];
+    }
+    ring->head += len;
+
+    // Wake the console task
+    if (cons_waiting) {
+        cons_waiting = 0;
+        pcb[cons_pid].trapframe_p->ebx = 0;
+        pcb[cons_pid].state = READY;
+        if (enqueue(pcb[cons_pid].queue, cons_pid) != 0) {
+            panic("CAN'T ENQUEUE CONSOLE TASK TO RUN QUEUE");
+        }
+    }
+
+    return len;
+}
+
+/**
+ * Makes a process the console task and has it wait until there is output
+ * to write
+ * @param  pid - console task
+ * @return 0 if there is output already, -1 if another process is the
+ *         console task, KSYSCALL_BLOCKED if it has to wait
+ */
+int kcons_wait(int pid) {
+    // Only one process may write out the buffers
+    if (cons_pid >= 0 && cons_pid != pid && pcb[cons_pid].state != AVAILABLE) {
+        return -1;
+    }
+    cons_pid = pid;
+
+    if (kcons_pending()) {
+        return 0;
+    }
+
+    cons_waiting = 1;
+    return KSYSCALL_BLOCKED;
+}
+
+/**
+ * Gives a new process a clean buffer: output the previous process on the
+ * same pid left unwritten is discarded and its drop count is not carried
+ * over. Both counters only move forward, so the console task never sees
+ * them go backwards.
+ * @param  pid - process being started
+ */
+void kcons_reset(int pid) {
+    cons_rings[pid].tail = cons_rings[pid].head;
+    cons_rings[pid].reported = cons_rings[pid].dropped;
+}
@@ -0,0 +1,40 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Console Service
+ */
+#ifndef KCONS_H
+#define KCONS_H
+
+// Longest record a process may log in one call (including the terminator)
+#define CONS_RECORD_MAX 256
+
+// Output buffered per process (must be a power of two)
+#define CONS_RING_SIZE 1024
+
+// Most bytes the console task writes before checking the other buffers
+#define CONS_BATCH 512
+
+// Per-process output buffer; the syscall handler only writes head and the
+// console task only writes tail (kcons_reset only moves tail forward), so
+// neither side needs a lock
+typedef struct cons_ring_t {
+    volatile unsigned int head;     // Bytes submitted
+    volatile unsigned int tail;     // Bytes written out
+    unsigned int dropped;           // Records that did not fit
+    unsigned int reported;          // Dropped records already reported
+    char buf[CONS_RING_SIZE];
+} cons_ring_t;
+
+/**
+ * Function declarations
+ */
+void kcons_init();
+void ktask_cons();
+int kcons_write(int pid, char *record, unsigned int len);
+int kcons_wait(int pid);
+void kcons_reset(int pid);
+
+#endif
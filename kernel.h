@@ -22,35 +22,107 @@
 // Process runtime stack size
 #define PROC_STACK_SIZE 8196
 
-// Maximum number of ticks a process may run before being rescheduled
-#define PROC_TICKS_MAX 50
+// Time a process may run before being rescheduled (milliseconds); the
+// number of ticks this takes depends on the timer frequency
+#define PROC_QUANTUM_MS 500
+
+// Number of process priorities (higher numbers are scheduled first)
+#define PROC_PRIO_MAX 4
+
+// Priority processes start with
+#define PROC_PRIO_DEFAULT 1
 
 //Maximum number of semaphores
 #define SEMAPHORE_MAX PROC_MAX
 
+//Maximum number of condition variables
+#define COND_MAX PROC_MAX
+
+//Maximum number of reader-writer locks
+#define RWLOCK_MAX PROC_MAX
+
+//Maximum number of event flag groups
+#define EVENT_MAX PROC_MAX
+
 //Maximum number of mailboxes
 #define MBOX_MAX PROC_MAX
 
-// Size of each mailbox
-#define MBOX_SIZE PROC_MAX
+// Largest number of messages a single mailbox may hold
+#define MBOX_CAPACITY_MAX 256
+
+// Maximum number of futex addresses waited on at once
+// (each waiting process waits on one, so this can never run out)
+#define FUTEX_MAX PROC_MAX
+
+// Maximum number of broadcast channels
+#define CHAN_MAX 8
+
+// Number of messages a broadcast channel can hold
+#define CHAN_SIZE 16
+
+// Bytes of a msg_t stored ahead of the message data
+#define MSG_HEADER_SIZE (sizeof(msg_t) - MSG_SIZE)
 
 /**
  * Kernel data types and definitions
  */
 
+//Semaphore types
+typedef enum {
+    SEM_TYPE_COUNTING,
+    SEM_TYPE_MUTEX
+} sem_type_t;
+
 //Semaphore Data Structure
+//A mutex is a semaphore entry that also tracks its owning process
 typedef struct {
     int count;
     int init;
+    sem_type_t type;
+    int owner;                  // owning pid of a mutex, -1 if unlocked
     queue_t wait_q;
 } semaphore_t;
 
+//Condition Variable Data Structure
+typedef struct {
+    int init;
+    queue_t wait_q;             // processes waiting for a signal
+} condition_t;
+
+//Reader-Writer Lock Data Structure
+typedef struct {
+    int init;
+    int readers;                // number of read locks held
+    int read_holds[PROC_MAX];   // read locks held by each pid
+    int writer;                 // pid holding the write lock, -1 if none
+    queue_t read_q;             // processes waiting for a read lock
+    queue_t write_q;            // processes waiting for the write lock
+} readwrite_lock_t;
+
+//Event Flag Group Data Structure
+//Waiters keep their mask and mode in their trapframe (ecx/edx) while
+//they are blocked
+typedef struct {
+    int init;
+    unsigned int flags;         // current flag word
+    queue_t wait_q;             // processes waiting for flags
+} event_group_t;
+
 //Mailbox Data Structure
+//Queued messages are kept in one FIFO list of slots per priority; unused
+//slots are kept on a free list. Lists are linked through next[].
 typedef struct {
-    msg_t messages[MBOX_SIZE];
-    int head;
-    int tail;
+    int in_use;                 // 1 if the mailbox has been created
+    int capacity;               // number of message slots
+    int msg_size;               // bytes of message data per slot
+    unsigned char *storage;     // capacity slots of MSG_HEADER_SIZE + msg_size
+    int *next;                  // next slot in the same list, -1 at the end
+    int free;                   // first free slot, -1 if full
+    int head[MSG_PRIO_MAX];     // oldest message of each priority
+    int tail[MSG_PRIO_MAX];     // newest message of each priority
+    int prio_mask;              // bit n is set if priority n has messages
     int size;
+    int reserved;               // free slots held back for promised messages
     queue_t wait_q;
 } mailbox_t;
 
@@ -64,10 +136,70 @@ typedef enum {
     SYSCALL_SEM_WAIT,
     SYSCALL_SEM_POST,
     SYSCALL_MSG_SEND,
-    SYSCALL_MSG_RECV
+    SYSCALL_MSG_RECV,
+    SYSCALL_MSG_SELECT,
+    SYSCALL_MBOX_CREATE,
+    SYSCALL_HANDLE_DESTROY,
+    SYSCALL_IPC_CALL,
+    SYSCALL_IPC_REPLY_WAIT,
+    SYSCALL_CHAN_CREATE,
+    SYSCALL_CHAN_SUBSCRIBE,
+    SYSCALL_CHAN_UNSUBSCRIBE,
+    SYSCALL_CHAN_PUBLISH,
+    SYSCALL_CHAN_RECV,
+    SYSCALL_FUTEX_WAIT,
+    SYSCALL_FUTEX_WAKE,
+    SYSCALL_SEM_TRYWAIT,
+    SYSCALL_SEM_TIMEDWAIT,
+    SYSCALL_MUTEX_INIT,
+    SYSCALL_MUTEX_LOCK,
+    SYSCALL_MUTEX_UNLOCK,
+    SYSCALL_SET_PROC_PRIO,
+    SYSCALL_COND_INIT,
+    SYSCALL_COND_WAIT,
+    SYSCALL_COND_SIGNAL,
+    SYSCALL_COND_BROADCAST,
+    SYSCALL_RWLOCK_INIT,
+    SYSCALL_RWLOCK_RDLOCK,
+    SYSCALL_RWLOCK_WRLOCK,
+    SYSCALL_RWLOCK_UNLOCK,
+    SYSCALL_EVENT_INIT,
+    SYSCALL_EVENT_SET,
+    SYSCALL_EVENT_CLEAR,
+    SYSCALL_EVENT_WAIT,
+    SYSCALL_CLOCK_GETTIME,
+    SYSCALL_NANOSLEEP,
+    SYSCALL_TIMER_CREATE,
+    SYSCALL_SET_TICK_HZ,
+    SYSCALL_SET_TIMER_SLACK,
+    SYSCALL_IRQ_STATS,
+    SYSCALL_READ_KEY,
+    SYSCALL_CONS_WRITE,
+    SYSCALL_CONS_WAIT,
+    SYSCALL_SERIAL_READ,
+    SYSCALL_SERIAL_WRITE,
+    SYSCALL_BLK_READ,
+    SYSCALL_BLK_WRITE,
+    SYSCALL_BLK_SYNC,
+    SYSCALL_FS_OPEN,
+    SYSCALL_FS_READ,
+    SYSCALL_FS_WRITE,
+    SYSCALL_FS_MMAP,
+    SYSCALL_FS_UNLINK,
+    SYSCALL_AIO_SUBMIT,
+    SYSCALL_TRACE_CTL,
+    SYSCALL_TRACE_READ,
+    SYSCALL_PROF_CTL,
+    SYSCALL_PROF_READ,
+    SYSCALL_PROC_SNAPSHOT
 } syscall_t;
 
 
+// Returned by a kernel service that queued the calling process to wait;
+// the system call handler blocks the process and the service sets the
+// result when it wakes it
+#define KSYSCALL_BLOCKED -2
+
 // Process states
 typedef enum {
     AVAILABLE,
@@ -77,14 +209,60 @@ typedef enum {
     WAITING
 } state_t;
 
+//Futex Data Structure
+typedef struct {
+    int *addr;                  // user address waited on, NULL if unused
+    queue_t wait_q;             // processes sleeping on the address
+} futex_t;
+
+// Broadcast Channel Data Structure
+// Messages are numbered by sequence; message n lives in slots[n % CHAN_SIZE]
+typedef struct {
+    int in_use;                 // 1 if the channel has been created
+    int policy;                 // chan_policy_e for a full channel
+    msg_t slots[CHAN_SIZE];     // stored messages
+    int refs[CHAN_SIZE];        // subscribers that have yet to read each slot
+    int head;                   // sequence of the oldest stored message
+    int tail;                   // sequence of the next message to publish
+    int subscribers;            // number of subscribed processes
+    int cursor[PROC_MAX];       // next sequence per pid, -1 if not subscribed
+    queue_t wait_q;             // subscribers waiting for a message
+    queue_t pub_wait_q;         // publishers waiting for a free slot
+} channel_t;
+
+// Synchronous IPC states
+typedef enum {
+    IPC_NONE,                       // not involved in a call
+    IPC_CALLING,                    // queued on a server's ipc_call_q
+    IPC_REPLY_WAIT,                 // call received, waiting for the reply
+    IPC_RECEIVING                   // server waiting for the next call
+} ipc_state_t;
+
 // The process control block for each process
 typedef struct {
     char name[PROC_NAME_LEN+1];     // Process name/title
     state_t state;                  // current process state
     queue_t *queue;                 // queue the process belongs to
-    int time;                       // run time since loaded
-    int total_time;                 // total run time since created
-    int wake_time;
+    int priority;                   // effective (possibly inherited) priority
+    int base_priority;              // priority set for the process itself
+    int blocked_on;                 // mutex the process is waiting for, -1 if none
+    int cond_mutex;                 // mutex to retake when a condition is signaled
+    int time;                       // timer ticks since loaded
+    int total_time;                 // timer ticks charged before that
+    int voluntary;                  // switches after it gave up the CPU (blocked, slept, exited)
+    int involuntary;                // switches to another process after a preemption
+    int preempted;                  // set if the last switch out was involuntary
+    unsigned long long switch_ns;   // kclock time of the last switch in or out
+    unsigned long long cpu_ns;      // run time, measured at each switch
+    unsigned long long wait_ns;     // time ready but not running after preemption
+    unsigned long long blocked_ns;  // time off the CPU after giving it up
+    unsigned long long wake_ns;     // kclock time at which to leave the sleep queue
+    unsigned int timer_slack_ns;    // how late a sleep may end to share a wakeup
+    queue_t *timeout_q;             // wait queue to leave when wake_ns passes
+    msg_select_t *select_p;         // select set the process is blocked on
+    ipc_state_t ipc_state;          // synchronous IPC state
+    int ipc_partner;                // server a calling process is talking to
+    queue_t ipc_call_q;             // clients calling this process
     trapframe_t *trapframe_p;       // process trapframe
 } pcb_t;
 
@@ -103,8 +281,28 @@ extern pcb_t pcb[PROC_MAX];
 extern semaphore_t semaphores[SEMAPHORE_MAX];
 extern queue_t semaphore_q;
 
+//Condition Variable Data Structures
+extern condition_t conditions[COND_MAX];
+extern queue_t condition_q;
+
+//Reader-Writer Lock Data Structures
+extern readwrite_lock_t rwlocks[RWLOCK_MAX];
+extern queue_t rwlock_q;
+
+//Event Flag Data Structures
+extern event_group_t events[EVENT_MAX];
+extern queue_t event_q;
+
 //Mailbox Data Structures
 extern mailbox_t mailboxes[MBOX_MAX];
+extern queue_t mailbox_q;
+
+//Futex Data Structures
+extern futex_t futexes[FUTEX_MAX];
+
+//Broadcast Channel Data Structures
+extern channel_t channels[CHAN_MAX];
+extern queue_t channel_q;
 
 // System time
 extern int system_time;
@@ -114,7 +312,7 @@ extern int run_pid;
 
 // Process queues
 extern queue_t available_q;
-extern queue_t run_q;
+extern queue_t run_q[PROC_PRIO_MAX];
 extern queue_t idle_q;
 extern queue_t sleep_q;
 
@@ -148,4 +346,11 @@ void panic_warn(char *msg);
  */
 void debug_printf(char *format, ...);
 
+/**
+ * Runs a special developer/debug command
+ * @param key   the key pressed
+ * @return 0 if the key was a command, -1 otherwise
+ */
+int kernel_command(char key);
+
 #endif
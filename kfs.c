@@ -0,0 +1,502 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * In-Memory File System
+ *
+ * Files live in fixed-size pages taken from a shared pool. Open files are
+ * kernel handles (HANDLE_FILE), so they are closed with handle_destroy()
+ * and reclaimed when their process exits.
+ *
+ * There is no paging, so mapping a file hands out the address of its
+ * storage. That needs the mapped pages to be adjacent in the pool: pages
+ * are allocated next to the previous page of the file where possible, and
+ * a file that is not contiguous is moved once when it is first mapped.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "khandle.h"
+#include "kfs.h"
+#include "string.h"
+
+static char fs_pages[FS_PAGES][FS_PAGE_SIZE] __attribute__((aligned(FS_PAGE_SIZE)));
+static int fs_page_used[FS_PAGES];
+
+static fs_file_t fs_files[FS_FILES];
+static fs_open_t fs_opens[FS_OPEN_MAX];
+
+/**
+ * Initializes the file system
+ */
+void kfs_init() {
+    int i;
+
+    sp_memset(fs_page_used, 0, sizeof(fs_page_used));
+    sp_memset(fs_files, 0, sizeof(fs_files));
+    sp_memset(fs_opens, 0, sizeof(fs_opens));
+
+    for (i = 0; i < FS_OPEN_MAX; i++) {
+        fs_opens[i].file = -1;
+    }
+}
+
+/**
+ * Takes a free storage page
+ * @param  hint - page to prefer (the one after the file's previous page)
+ * @return page index, -1 if the pool is exhausted
+ */
+static int fs_page_alloc(int hint) {
+    int i;
+
+    if (hint >= 0 && hint < FS_PAGES && !fs_page_used[hint]) {
+        fs_page_used[hint] = 1;
+        return hint;
+    }
+
+    for (i = 0; i < FS_PAGES; i++) {
+        if (!fs_page_used[i]) {
+            fs_page_used[i] = 1;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Frees a file's storage
+ * @param  file - file to empty
+ */
+static void fs_truncate(fs_file_t *file) {
+    int i;
+
+    for (i = 0; i < FS_FILE_PAGES; i++) {
+        if (file->pages[i] >= 0) {
+            fs_page_used[file->pages[i]] = 0;
+            file->pages[i] = -1;
+        }
+    }
+    file->size = 0;
+}
+
+/**
+ * Finds a file by name
+ * @param  name - file name
+ * @return file index, -1 if there is no such file
+ */
+static int fs_lookup(char *name) {
+    int i;
+
+    for (i = 0; i < FS_FILES; i++) {
+        if (fs_files[i].in_use && !fs_files[i].unlinked &&
+            sp_strcmp(fs_files[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Creates an empty file
+ * @param  name - file name
+ * @return file index, -1 if the file table is full
+ */
+static int fs_create(char *name) {
+    int i;
+    int j;
+
+    for (i = 0; i < FS_FILES; i++) {
+        if (!fs_files[i].in_use) {
+            sp_memset(&fs_files[i], 0, sizeof(fs_file_t));
+            fs_files[i].in_use = 1;
+            sp_strncpy(fs_files[i].name, name, FS_NAME_LEN);
+            for (j = 0; j < FS_FILE_PAGES; j++) {
+                fs_files[i].pages[j] = -1;
+            }
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Releases a file that is no longer open, freeing it if it was unlinked
+ * @param  num - file index
+ */
+static void fs_release(int num) {
+    if (fs_files[num].opens == 0 && fs_files[num].unlinked) {
+        fs_truncate(&fs_files[num]);
+        fs_files[num].in_use = 0;
+    }
+}
+
+/**
+ * Looks up an open file handle
+ * @param  handle - file handle
+ * @return open file, NULL if the handle is not an open file
+ */
+static fs_open_t *fs_open_lookup(int handle) {
+    int num = khandle_lookup(handle, HANDLE_FILE);
+
+    if (num < 0) {
+        return NULL;
+    }
+    return &fs_opens[num];
+}
+
+/**
+ * Closes an open file (called when its handle is destroyed)
+ * @param  num - open file index
+ */
+void kfs_close(int num) {
+    fs_file_t *file;
+
+    if (num < 0 || num >= FS_OPEN_MAX || fs_opens[num].file < 0) {
+        panic("Invalid open file");
+    }
+
+    file = &fs_files[fs_opens[num].file];
+    if (fs_opens[num].mapped) {
+        file->maps--;
+    }
+    file->opens--;
+    fs_release(fs_opens[num].file);
+
+    fs_opens[num].file = -1;
+}
+
+/**
+ * Opens a file by name
+ * @param  name  - file name
+ * @param  flags - FS_O_CREAT, FS_O_TRUNC and FS_O_APPEND or-ed together
+ * @param  owner - process the handle belongs to
+ * @return handle of the open file, -1 on error
+ */
+int kfs_open(char *name, int flags, int owner) {
+    int num;
+    int f;
+    int handle;
+    int created = 0;
+
+    if (name == NULL) {
+        panic("NULL POINTER");
+    }
+    if (name[0] == '\0' || sp_strlen(name) >= FS_NAME_LEN) {
+        return -1;
+    }
+
+    for (num = 0; num < FS_OPEN_MAX && fs_opens[num].file >= 0; num++);
+    if (num == FS_OPEN_MAX) {
+        return -1;
+    }
+
+    f = fs_lookup(name);
+    if (f < 0) {
+        if (!(flags & FS_O_CREAT)) {
+            return -1;
+        }
+        f = fs_create(name);
+        if (f < 0) {
+            return -1;
+        }
+        created = 1;
+    }
+
+    handle = khandle_alloc(HANDLE_FILE, num, owner);
+    if (handle < 0) {
+        // A failed open leaves no new file behind
+        if (created) {
+            fs_files[f].in_use = 0;
+        }
+        return -1;
+    }
+
+    // Mapped contents must stay where they are
+    if ((flags & FS_O_TRUNC) && fs_files[f].maps == 0) {
+        fs_truncate(&fs_files[f]);
+    }
+
+    fs_files[f].opens++;
+    fs_opens[num].file = f;
+    fs_opens[num].offset = 0;
+    fs_opens[num].flags = flags;
+    fs_opens[num].mapped = 0;
+
+    return handle;
+}
+
+/**
+ * Reads from an open file at an offset
+ * @param  handle - file handle
+ * @param  buf    - destination buffer
+ * @param  len    - most bytes to read
+ * @param  offset - position in the file
+ * @return number of bytes read (0 at the end of the file), -1 on error
+ */
+int kfs_pread(int handle, char *buf, int len, int offset) {
+    fs_open_t *op = fs_open_lookup(handle);
+    fs_file_t *file;
+    int n;
+    int chunk;
+    int page;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+    if (op == NULL || len < 0 || offset < 0) {
+        return -1;
+    }
+
+    // The file may have been truncated through another handle
+    file = &fs_files[op->file];
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (len > file->size - offset) {
+        len = file->size - offset;
+    }
+
+    for (n = 0; n < len; n += chunk) {
+        page = file->pages[offset / FS_PAGE_SIZE];
+        chunk = FS_PAGE_SIZE - offset % FS_PAGE_SIZE;
+        if (chunk > len - n) {
+            chunk = len - n;
+        }
+
+        // A page that was never written reads as zeros
+        if (page < 0) {
+            sp_memset(buf + n, 0, chunk);
+        } else {
+            sp_memcpy(buf + n, &fs_pages[page][offset % FS_PAGE_SIZE], chunk);
+        }
+        offset += chunk;
+    }
+
+    return len;
+}
+
+/**
+ * Writes to an open file at an offset, growing it as needed
+ * @param  handle - file handle
+ * @param  buf    - data to write
+ * @param  len    - number of bytes to write
+ * @param  offset - position in the file (at most its size)
+ * @return number of bytes written, -1 if nothing could be written
+ */
+int kfs_pwrite(int handle, char *buf, int len, int offset) {
+    fs_open_t *op = fs_open_lookup(handle);
+    fs_file_t *file;
+    int n;
+    int chunk;
+    int page;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+    if (op == NULL || len < 0 || offset < 0) {
+        return -1;
+    }
+
+    // Files cannot have holes
+    file = &fs_files[op->file];
+    if (offset > file->size) {
+        return -1;
+    }
+    if (len > FS_FILE_MAX - offset) {
+        len = FS_FILE_MAX - offset;
+    }
+
+    for (n = 0; n < len; n += chunk) {
+        page = offset / FS_PAGE_SIZE;
+
+        if (file->pages[page] < 0) {
+            file->pages[page] = fs_page_alloc(page > 0 ? file->pages[page - 1] + 1 : -1);
+            if (file->pages[page] < 0) {
+                break;
+            }
+            sp_memset(fs_pages[file->pages[page]], 0, FS_PAGE_SIZE);
+        }
+
+        chunk = FS_PAGE_SIZE - offset % FS_PAGE_SIZE;
+        if (chunk > len - n) {
+            chunk = len - n;
+        }
+        sp_memcpy(&fs_pages[file->pages[page]][offset % FS_PAGE_SIZE], buf + n, chunk);
+        offset += chunk;
+    }
+
+    if (offset > file->size) {
+        file->size = offset;
+    }
+
+    // Only fail if nothing could be written
+    return (n == 0 && len > 0) ? -1 : n;
+}
+
+/**
+ * Reads from the current position of an open file and moves past the
+ * bytes read
+ * @param  handle - file handle
+ * @param  buf    - destination buffer
+ * @param  len    - most bytes to read
+ * @return number of bytes read (0 at the end of the file), -1 on error
+ */
+int kfs_read(int handle, char *buf, int len) {
+    fs_open_t *op = fs_open_lookup(handle);
+    int rc;
+
+    rc = kfs_pread(handle, buf, len, op != NULL ? op->offset : 0);
+
+    if (rc > 0) {
+        op->offset += rc;
+    }
+    return rc;
+}
+
+/**
+ * Writes at the current position of an open file (its end if it was opened
+ * with FS_O_APPEND) and moves past the bytes written
+ * @param  handle - file handle
+ * @param  buf    - data to write
+ * @param  len    - number of bytes to write
+ * @return number of bytes written, -1 if nothing could be written
+ */
+int kfs_write(int handle, char *buf, int len) {
+    fs_open_t *op = fs_open_lookup(handle);
+    int rc;
+
+    if (op != NULL && (op->flags & FS_O_APPEND)) {
+        op->offset = fs_files[op->file].size;
+    }
+
+    rc = kfs_pwrite(handle, buf, len, op != NULL ? op->offset : 0);
+
+    if (rc > 0) {
+        op->offset += rc;
+    }
+    return rc;
+}
+
+/**
+ * Checks whether the first pages of a file are allocated and adjacent in
+ * the pool
+ * @param  file  - file to check
+ * @param  count - number of pages
+ * @return 1 if they are, 0 otherwise
+ */
+static int fs_contiguous(fs_file_t *file, int count) {
+    int i;
+
+    if (file->pages[0] < 0) {
+        return 0;
+    }
+
+    for (i = 1; i < count; i++) {
+        if (file->pages[i] != file->pages[0] + i) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Moves the first pages of a file next to each other in the pool
+ * @param  file  - file to move
+ * @param  count - number of pages that must be adjacent
+ * @return 0 on success, -1 if there is no run of free pages long enough
+ */
+static int fs_make_contiguous(fs_file_t *file, int count) {
+    int start;
+    int i;
+
+    if (fs_contiguous(file, count)) {
+        return 0;
+    }
+
+    // Find count free pages in a row
+    for (start = 0; start + count <= FS_PAGES; start++) {
+        for (i = 0; i < count && !fs_page_used[start + i]; i++);
+        if (i == count) {
+            break;
+        }
+    }
+    if (start + count > FS_PAGES) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        fs_page_used[start + i] = 1;
+        if (file->pages[i] >= 0) {
+            sp_memcpy(fs_pages[start + i], fs_pages[file->pages[i]], FS_PAGE_SIZE);
+            fs_page_used[file->pages[i]] = 0;
+        } else {
+            sp_memset(fs_pages[start + i], 0, FS_PAGE_SIZE);
+        }
+        file->pages[i] = start + i;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns the address of a file's contents so it can be used in place; the
+ * mapping stays valid until the file is closed
+ * @param  handle - file handle
+ * @param  offset - start of the mapping in the file (page aligned)
+ * @param  len    - length of the mapping (within the file)
+ * @return address of the mapped contents, NULL on error
+ */
+char *kfs_mmap(int handle, int offset, int len) {
+    fs_open_t *op = fs_open_lookup(handle);
+    fs_file_t *file;
+    int count;
+
+    if (op == NULL || offset < 0 || len <= 0 || offset % FS_PAGE_SIZE != 0) {
+        return NULL;
+    }
+
+    file = &fs_files[op->file];
+    if (len > file->size - offset) {
+        return NULL;
+    }
+
+    // Pages up to the end of the mapping; a file that is already mapped
+    // cannot be moved
+    count = (offset + len + FS_PAGE_SIZE - 1) / FS_PAGE_SIZE;
+    if (file->maps > 0 ? !fs_contiguous(file, count) : fs_make_contiguous(file, count) != 0) {
+        return NULL;
+    }
+
+    if (!op->mapped) {
+        op->mapped = 1;
+        file->maps++;
+    }
+
+    return &fs_pages[file->pages[offset / FS_PAGE_SIZE]][0];
+}
+
+/**
+ * Removes a file by name; its storage is freed once it is no longer open
+ * @param  name - file name
+ * @return 0 on success, -1 if there is no such file
+ */
+int kfs_unlink(char *name) {
+    int f;
+
+    if (name == NULL) {
+        panic("NULL POINTER");
+    }
+
+    f = fs_lookup(name);
+    if (f < 0) {
+        return -1;
+    }
+
+    fs_files[f].unlinked = 1;
+    fs_release(f);
+    return 0;
+}
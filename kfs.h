@@ -0,0 +1,63 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * In-Memory File System
+ */
+#ifndef KFS_H
+#define KFS_H
+
+// Storage page size and number of pages shared by all files
+#define FS_PAGE_SIZE 4096
+#define FS_PAGES 64
+
+// Most files and most pages per file
+#define FS_FILES 32
+#define FS_FILE_PAGES 16
+#define FS_FILE_MAX (FS_FILE_PAGES * FS_PAGE_SIZE)
+
+// Longest file name (including the terminator)
+#define FS_NAME_LEN 32
+
+// Files that may be open at once
+#define FS_OPEN_MAX 32
+
+// fs_open() flags
+#define FS_O_CREAT 0x1          // create the file if it does not exist
+#define FS_O_TRUNC 0x2          // discard the file's contents
+#define FS_O_APPEND 0x4         // write at the end of the file
+
+// File
+typedef struct fs_file_t {
+    int in_use;
+    char name[FS_NAME_LEN];
+    int size;                       // Bytes in the file
+    int pages[FS_FILE_PAGES];       // Storage page of each page, -1 if none
+    int opens;                      // Open files referring to it
+    int maps;                       // Open files that have mapped it
+    int unlinked;                   // Freed once the last open file closes
+} fs_file_t;
+
+// Open file
+typedef struct fs_open_t {
+    int file;                       // File index, -1 if the entry is free
+    int offset;                     // Position of the next read or write
+    int flags;                      // fs_open() flags
+    int mapped;                     // Set once the file has been mapped
+} fs_open_t;
+
+/**
+ * Function declarations
+ */
+void kfs_init();
+void kfs_close(int num);
+int kfs_pread(int handle, char *buf, int len, int offset);
+int kfs_pwrite(int handle, char *buf, int len, int offset);
+int kfs_open(char *name, int flags, int owner);
+int kfs_read(int handle, char *buf, int len);
+int kfs_write(int handle, char *buf, int len);
+char *kfs_mmap(int handle, int offset, int len);
+int kfs_unlink(char *name);
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Object Handles
+ *
+ * Every semaphore, mutex, condition variable, reader-writer lock, event
+ * flag group, mailbox, broadcast channel and timer is named by a handle.
+ * The low bits of a handle select a slot in the handle table and the high
+ * bits must match the slot's generation, which changes whenever the slot
+ * is freed; a stale handle can therefore never reach a recycled object.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "khandle.h"
+#include "ksyscall.h"
+#include "ktimer.h"
+#include "kfs.h"
+#include "string.h"
+
+// Handle table
+static handle_t handles[HANDLE_MAX];
+
+// First free handle slot, -1 if the table is full
+static int handle_free;
+
+/**
+ * Initializes the handle table so that every slot is free
+ */
+void khandle_init() {
+    int i;
+
+    sp_memset(handles, 0, sizeof(handles));
+
+    for (i = 0; i < HANDLE_MAX; i++) {
+        handles[i].type = HANDLE_FREE;
+        handles[i].generation = 1;
+        handles[i].next_free = i + 1;
+    }
+    handles[HANDLE_MAX - 1].next_free = -1;
+    handle_free = 0;
+}
+
+/**
+ * Allocates a handle for a kernel object
+ * @param  type   - kind of object
+ * @param  object - index of the object in its own table
+ * @param  owner  - creating process; its objects are destroyed when it exits
+ * @return the handle; -1 if the table is full
+ */
+int khandle_alloc(handle_type_t type, int object, int owner) {
+    int slot = handle_free;
+
+    if (slot < 0) {
+        return -1;
+    }
+
+    handle_free = handles[slot].next_free;
+    handles[slot].type = type;
+    handles[slot].owner = owner;
+    handles[slot].object = object;
+
+    return (handles[slot].generation << HANDLE_INDEX_BITS) | slot;
+}
+
+/**
+ * Resolves a handle to the object it names
+ * @param  handle - handle to resolve
+ * @param  type   - kind of object the caller expects
+ * @return the object index; -1 if the handle is stale, unknown or names a
+ *         different kind of object
+ */
+int khandle_lookup(int handle, handle_type_t type) {
+    int slot;
+
+    if (handle < 0) {
+        return -1;
+    }
+
+    slot = handle & HANDLE_INDEX_MASK;
+
+    if (slot >= HANDLE_MAX || handles[slot].type != type
+        || handles[slot].generation != (handle >> HANDLE_INDEX_BITS)) {
+        return -1;
+    }
+    return handles[slot].object;
+}
+
+/**
+ * Resolves the handle stored at handle_p, creating a new object when it
+ * does not name a live object of the given type (the init syscalls)
+ * @param  handle_p - user pointer to the handle; updated with a new handle
+ * @param  type     - kind of object
+ * @param  free_q   - queue of free indexes in the object's table
+ * @return the object index; -1 if no object or handle is available
+ */
+int khandle_open(int *handle_p, handle_type_t type, queue_t *free_q) {
+    int num;
+    int handle;
+
+    num = khandle_lookup(*handle_p, type);
+    if (num >= 0) {
+        return num;
+    }
+
+    if (dequeue(free_q, &num) != 0) {
+        return -1;
+    }
+
+    handle = khandle_alloc(type, num, run_pid);
+    if (handle < 0) {
+        enqueue(free_q, num);
+        return -1;
+    }
+
+    *handle_p = handle;
+    return num;
+}
+
+/**
+ * Destroys the object a handle names and frees the handle
+ * Processes blocked on the object are woken with an error.
+ * @param  handle - handle to destroy
+ * @param  type   - kind of object the caller expects
+ * @return 0 on success; -1 if the handle is stale or of another type
+ */
+int khandle_destroy(int handle, handle_type_t type) {
+    int num;
+    int slot;
+
+    num = khandle_lookup(handle, type);
+    if (num < 0) {
+        return -1;
+    }
+
+    // Free the slot first so the object is unreachable while torn down
+    slot = handle & HANDLE_INDEX_MASK;
+    handles[slot].type = HANDLE_FREE;
+    handles[slot].generation++;
+    if (handles[slot].generation >= HANDLE_GENERATION_MAX) {
+        handles[slot].generation = 1;
+    }
+    handles[slot].next_free = handle_free;
+    handle_free = slot;
+
+    switch (type) {
+        case HANDLE_SEMAPHORE:
+        case HANDLE_MUTEX:
+            sem_free(num);
+            break;
+        case HANDLE_COND:
+            cond_free(num);
+            break;
+        case HANDLE_RWLOCK:
+            rwlock_free(num);
+            break;
+        case HANDLE_EVENT:
+            event_free(num);
+            break;
+        case HANDLE_MBOX:
+            mbox_free(num);
+            break;
+        case HANDLE_CHAN:
+            chan_free(num);
+            break;
+        case HANDLE_TIMER:
+            ktimer_free(num);
+            break;
+        case HANDLE_FILE:
+            kfs_close(num);
+            break;
+        default:
+            panic("Invalid handle type");
+            break;
+    }
+    return 0;
+}
+
+/**
+ * Destroys every object created by a process
+ * @param  pid - the exiting process
+ */
+void khandle_reclaim(int pid) {
+    int slot;
+
+    for (slot = 0; slot < HANDLE_MAX; slot++) {
+        if (handles[slot].type != HANDLE_FREE && handles[slot].owner == pid) {
+            khandle_destroy((handles[slot].generation << HANDLE_INDEX_BITS) | slot,
+                            handles[slot].type);
+        }
+    }
+}
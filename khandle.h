@@ -0,0 +1,54 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Object Handles
+ */
+#ifndef KHANDLE_H
+#define KHANDLE_H
+
+#include "queue.h"
+
+// Number of handles that may be open at once
+#define HANDLE_MAX 128
+
+// Handles are built as (generation << HANDLE_INDEX_BITS) | slot
+#define HANDLE_INDEX_BITS 8
+#define HANDLE_INDEX_MASK ((1 << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MAX (1 << (30 - HANDLE_INDEX_BITS))
+
+// Kinds of kernel object a handle can refer to
+typedef enum {
+    HANDLE_FREE,
+    HANDLE_SEMAPHORE,
+    HANDLE_MUTEX,
+    HANDLE_COND,
+    HANDLE_RWLOCK,
+    HANDLE_EVENT,
+    HANDLE_MBOX,
+    HANDLE_CHAN,
+    HANDLE_TIMER,
+    HANDLE_FILE
+} handle_type_t;
+
+// Handle table entry
+typedef struct {
+    handle_type_t type;         // kind of object, HANDLE_FREE if unused
+    int generation;             // bumped each time the slot is freed
+    int owner;                  // pid that created the object
+    int object;                 // index into the object's own table
+    int next_free;              // next free slot, -1 at the end
+} handle_t;
+
+/**
+ * Function declarations
+ */
+void khandle_init();
+int khandle_alloc(handle_type_t type, int object, int owner);
+int khandle_lookup(int handle, handle_type_t type);
+int khandle_open(int *handle_p, handle_type_t type, queue_t *free_q);
+int khandle_destroy(int handle, handle_type_t type);
+void khandle_reclaim(int pid);
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Hardware Interrupt (IRQ) Handling
+ *
+ * Drivers register a handler per IRQ line; registering a handler unmasks
+ * the line at the PIC and unregistering masks it again. Every IRQ vector
+ * is routed to kirq_dispatch(), which runs the handler, keeps statistics
+ * and sends a specific end-of-interrupt for the line.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kclock.h"
+#include "kirq.h"
+#include "ktrace.h"
+#include "string.h"
+
+// Registered IRQ line
+typedef struct {
+    char *name;                     // driver name shown in statistics
+    irq_handler_t handler;          // handler, NULL if the line is free
+    int count;                      // interrupts handled
+    int spurious;                   // spurious interrupts ignored
+    int unhandled;                  // interrupts with no handler
+    unsigned long long cycles;      // total handler run time
+    unsigned long long max_cycles;  // longest single handler run
+} kirq_t;
+
+static kirq_t irqs[IRQ_MAX];
+
+// Current PIC masks (bit set = line masked), master in the low byte
+static unsigned int irq_mask;
+
+// Interrupted state while a handler runs
+static trapframe_t *irq_frame;
+
+/**
+ * Writes the current mask to both PICs
+ */
+static void kirq_write_mask() {
+    outportb(PIC1_DATA, irq_mask & 0xff);
+    outportb(PIC2_DATA, (irq_mask >> 8) & 0xff);
+}
+
+/**
+ * Initializes IRQ handling with every line masked
+ */
+void kirq_init() {
+    sp_memset(irqs, 0, sizeof(irqs));
+
+    irq_mask = 0xffff;
+    kirq_write_mask();
+}
+
+/**
+ * Registers the handler for an IRQ line and unmasks the line
+ * @param  irq     - IRQ line (0 to IRQ_MAX - 1)
+ * @param  name    - driver name shown in statistics
+ * @param  handler - function called on each interrupt
+ * @return 0 on success, -1 if the line is invalid or already taken
+ */
+int kirq_register(int irq, char *name, irq_handler_t handler) {
+    if (irq < 0 || irq >= IRQ_MAX || irq == IRQ_CASCADE
+        || handler == NULL || irqs[irq].handler != NULL) {
+        return -1;
+    }
+
+    irqs[irq].name = name;
+    irqs[irq].handler = handler;
+    kirq_unmask(irq);
+    return 0;
+}
+
+/**
+ * Masks an IRQ line and removes its handler
+ * @param  irq - IRQ line
+ */
+void kirq_unregister(int irq) {
+    if (irq < 0 || irq >= IRQ_MAX) {
+        return;
+    }
+
+    kirq_mask(irq);
+    irqs[irq].handler = NULL;
+}
+
+/**
+ * Masks an IRQ line at the PIC
+ * @param  irq - IRQ line
+ */
+void kirq_mask(int irq) {
+    irq_mask |= (1 << irq);
+
+    // Close the cascade once no slave line is open
+    if ((irq_mask & 0xff00) == 0xff00) {
+        irq_mask |= (1 << IRQ_CASCADE);
+    }
+    kirq_write_mask();
+}
+
+/**
+ * Unmasks an IRQ line at the PIC
+ * @param  irq - IRQ line
+ */
+void kirq_unmask(int irq) {
+    irq_mask &= ~(1 << irq);
+
+    // Slave lines reach the CPU through the cascade line of the master
+    if (irq >= 8) {
+        irq_mask &= ~(1 << IRQ_CASCADE);
+    }
+    kirq_write_mask();
+}
+
+/**
+ * Sends a specific end-of-interrupt for an IRQ line
+ * @param  irq - IRQ line
+ */
+static void kirq_eoi(int irq) {
+    if (irq >= 8) {
+        outportb(PIC2_CMD, PIC_EOI_SPECIFIC | (irq - 8));
+        outportb(PIC1_CMD, PIC_EOI_SPECIFIC | IRQ_CASCADE);
+    } else {
+        outportb(PIC1_CMD, PIC_EOI_SPECIFIC | irq);
+    }
+}
+
+/**
+ * Checks whether the PIC really has an IRQ line in service
+ * IRQ 7 and 15 are also raised when a request goes away before it is
+ * acknowledged; those must not be acknowledged.
+ * @param  irq - IRQ line
+ * @return 1 if the interrupt is spurious, 0 otherwise
+ */
+static int kirq_spurious(int irq) {
+    int isr;
+
+    if (irq != 7 && irq != 15) {
+        return 0;
+    }
+
+    outportb(PIC1_CMD, PIC_READ_ISR);
+    outportb(PIC2_CMD, PIC_READ_ISR);
+    isr = inportb(PIC1_CMD) | (inportb(PIC2_CMD) << 8);
+
+    return (isr & (1 << irq)) == 0;
+}
+
+/**
+ * Handles an IRQ: runs its handler, records statistics and sends EOI
+ * @param  irq       - IRQ line
+ * @param  trapframe - state of the interrupted code
+ */
+void kirq_dispatch(int irq, trapframe_t *trapframe) {
+    kirq_t *line;
+    trapframe_t *prev_frame;
+    unsigned long long start;
+    unsigned long long elapsed;
+
+    if (irq < 0 || irq >= IRQ_MAX) {
+        panic("Invalid IRQ");
+    }
+
+    line = &irqs[irq];
+
+    if (kirq_spurious(irq)) {
+        line->spurious++;
+        // A spurious IRQ 15 was still acknowledged by the master
+        if (irq == 15) {
+            outportb(PIC1_CMD, PIC_EOI_SPECIFIC | IRQ_CASCADE);
+        }
+        return;
+    }
+
+    if (line->handler == NULL) {
+        line->unhandled++;
+        kirq_mask(irq);
+        kirq_eoi(irq);
+        return;
+    }
+
+    KTRACE(TRACE_IRQ, TRACE_EV_IRQ_ENTER, run_pid, irq);
+    // Nested interrupts put back the frame of the one they interrupted
+    prev_frame = irq_frame;
+    irq_frame = trapframe;
+
+    start = kclock_cycles();
+    line->handler(irq);
+    elapsed = kclock_cycles() - start;
+
+    irq_frame = prev_frame;
+    KTRACE(TRACE_IRQ, TRACE_EV_IRQ_EXIT, run_pid, irq);
+
+    line->count++;
+    line->cycles += elapsed;
+    if (elapsed > line->max_cycles) {
+        line->max_cycles = elapsed;
+    }
+
+    kirq_eoi(irq);
+}
+
+/**
+ * Returns the state interrupted by the IRQ being handled
+ * @return trapframe of the interrupted code, NULL outside an IRQ handler
+ */
+trapframe_t *kirq_frame() {
+    return irq_frame;
+}
+
+/**
+ * Copies the statistics of an IRQ line
+ * @param  irq   - IRQ line
+ * @param  stats - destination
+ * @return 0 on success, -1 if the line is invalid
+ */
+int kirq_stats(int irq, irq_stats_t *stats) {
+    if (irq < 0 || irq >= IRQ_MAX) {
+        return -1;
+    }
+
+    stats->count = irqs[irq].count;
+    stats->spurious = irqs[irq].spurious;
+    stats->unhandled = irqs[irq].unhandled;
+    stats->total_ns = (int)kclock_cycles_to_ns(irqs[irq].cycles);
+    stats->max_ns = (int)kclock_cycles_to_ns(irqs[irq].max_cycles);
+    return 0;
+}
+
+/**
+ * Prints the statistics of every line that has seen interrupts
+ */
+void kirq_dump() {
+    irq_stats_t stats;
+    int irq;
+
+    for (irq = 0; irq < IRQ_MAX; irq++) {
+        kirq_stats(irq, &stats);
+
+        if (irqs[irq].handler == NULL && stats.count == 0
+            && stats.spurious == 0 && stats.unhandled == 0) {
+            continue;
+        }
+
+        cons_printf("irq %d %s count=%d spurious=%d unhandled=%d max=%dns\n",
+                    irq, irqs[irq].handler ? irqs[irq].name : "-",
+                    stats.count, stats.spurious, stats.unhandled, stats.max_ns);
+    }
+}
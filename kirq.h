@@ -0,0 +1,63 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Hardware Interrupt (IRQ) Handling
+ */
+#ifndef KIRQ_H
+#define KIRQ_H
+
+// Number of IRQ lines on the two cascaded 8259 PICs
+#define IRQ_MAX 16
+
+// Interrupt vector of IRQ 0; IRQ n arrives on vector IRQ_BASE + n
+#define IRQ_BASE 0x20
+
+// IRQ lines with fixed uses
+#define IRQ_TIMER 0
+#define IRQ_KEYBOARD 1
+#define IRQ_CASCADE 2
+#define IRQ_COM2 3
+#define IRQ_COM1 4
+#define IRQ_ATA_PRIMARY 14
+
+// 8259 PIC ports and commands
+#define PIC1_CMD 0x20
+#define PIC1_DATA 0x21
+#define PIC2_CMD 0xA0
+#define PIC2_DATA 0xA1
+#define PIC_EOI_SPECIFIC 0x60
+#define PIC_READ_ISR 0x0B
+
+#ifndef ASSEMBLER
+#include "trapframe.h"
+
+// Per-IRQ statistics, as returned by irq_stats()
+typedef struct {
+    int count;                  // interrupts handled
+    int spurious;               // spurious interrupts ignored
+    int unhandled;              // interrupts with no handler registered
+    int total_ns;               // total handler run time (wraps)
+    int max_ns;                 // longest single handler run
+} irq_stats_t;
+
+// IRQ handler; runs with interrupts disabled and may only record state
+// and raise deferred work
+typedef void (*irq_handler_t)(int irq);
+
+/**
+ * Function declarations
+ */
+void kirq_init();
+int kirq_register(int irq, char *name, irq_handler_t handler);
+void kirq_unregister(int irq);
+void kirq_mask(int irq);
+void kirq_unmask(int irq);
+void kirq_dispatch(int irq, trapframe_t *trapframe);
+trapframe_t *kirq_frame();
+int kirq_stats(int irq, irq_stats_t *stats);
+void kirq_dump();
+#endif
+
+#endif
@@ -13,6 +13,18 @@
 #include "queue.h"
 #include "string.h"
 #include "ksyscall.h"
+#include "kclock.h"
+#include "ktimer.h"
+#include "kwork.h"
+#include "kirq.h"
+#include "ktrace.h"
+#include "kprof.h"
+
+// Deferred work raised by the timer interrupt
+static int timer_work;
+
+// Ticks not yet charged to a process by the timer work
+static volatile int timer_ticks;
 
 void kisr_syscall(){
     int valueFromEAX;
@@ -49,82 +61,255 @@ void kisr_syscall(){
         case SYSCALL_SEM_POST:
             ksyscall_sem_post();
             break;
+        case SYSCALL_SEM_TRYWAIT:
+            ksyscall_sem_trywait();
+            break;
+        case SYSCALL_SEM_TIMEDWAIT:
+            ksyscall_sem_timedwait();
+            break;
+        case SYSCALL_MUTEX_INIT:
+            ksyscall_mutex_init();
+            break;
+        case SYSCALL_MUTEX_LOCK:
+            ksyscall_mutex_lock();
+            break;
+        case SYSCALL_MUTEX_UNLOCK:
+            ksyscall_mutex_unlock();
+            break;
+        case SYSCALL_SET_PROC_PRIO:
+            ksyscall_set_proc_prio();
+            break;
+        case SYSCALL_PROC_SNAPSHOT:
+            ksyscall_proc_snapshot();
+            break;
+        case SYSCALL_COND_INIT:
+            ksyscall_cond_init();
+            break;
+        case SYSCALL_COND_WAIT:
+            ksyscall_cond_wait();
+            break;
+        case SYSCALL_COND_SIGNAL:
+            ksyscall_cond_signal();
+            break;
+        case SYSCALL_COND_BROADCAST:
+            ksyscall_cond_broadcast();
+            break;
+        case SYSCALL_RWLOCK_INIT:
+            ksyscall_rwlock_init();
+            break;
+        case SYSCALL_RWLOCK_RDLOCK:
+            ksyscall_rwlock_rdlock();
+            break;
+        case SYSCALL_RWLOCK_WRLOCK:
+            ksyscall_rwlock_wrlock();
+            break;
+        case SYSCALL_RWLOCK_UNLOCK:
+            ksyscall_rwlock_unlock();
+            break;
+        case SYSCALL_EVENT_INIT:
+            ksyscall_event_init();
+            break;
+        case SYSCALL_EVENT_SET:
+            ksyscall_event_set();
+            break;
+        case SYSCALL_EVENT_CLEAR:
+            ksyscall_event_clear();
+            break;
+        case SYSCALL_EVENT_WAIT:
+            ksyscall_event_wait();
+            break;
+        case SYSCALL_CLOCK_GETTIME:
+            ksyscall_clock_gettime();
+            break;
+        case SYSCALL_NANOSLEEP:
+            ksyscall_nanosleep();
+            break;
+        case SYSCALL_TIMER_CREATE:
+            ksyscall_timer_create();
+            break;
+        case SYSCALL_SET_TICK_HZ:
+            ksyscall_set_tick_hz();
+            break;
+        case SYSCALL_SET_TIMER_SLACK:
+            ksyscall_set_timer_slack();
+            break;
+        case SYSCALL_IRQ_STATS:
+            ksyscall_irq_stats();
+            break;
+        case SYSCALL_READ_KEY:
+            ksyscall_read_key();
+            break;
+        case SYSCALL_CONS_WRITE:
+            ksyscall_cons_write();
+            break;
+        case SYSCALL_CONS_WAIT:
+            ksyscall_cons_wait();
+            break;
+        case SYSCALL_SERIAL_READ:
+            ksyscall_serial_read();
+            break;
+        case SYSCALL_SERIAL_WRITE:
+            ksyscall_serial_write();
+            break;
+        case SYSCALL_BLK_READ:
+            ksyscall_blk_read();
+            break;
+        case SYSCALL_BLK_WRITE:
+            ksyscall_blk_write();
+            break;
+        case SYSCALL_BLK_SYNC:
+            ksyscall_blk_sync();
+            break;
+        case SYSCALL_FS_OPEN:
+            ksyscall_fs_open();
+            break;
+        case SYSCALL_FS_READ:
+            ksyscall_fs_read();
+            break;
+        case SYSCALL_FS_WRITE:
+            ksyscall_fs_write();
+            break;
+        case SYSCALL_FS_MMAP:
+            ksyscall_fs_mmap();
+            break;
+        case SYSCALL_FS_UNLINK:
+            ksyscall_fs_unlink();
+            break;
+        case SYSCALL_AIO_SUBMIT:
+            ksyscall_aio_submit();
+            break;
+        case SYSCALL_TRACE_CTL:
+            ksyscall_trace_ctl();
+            break;
+        case SYSCALL_TRACE_READ:
+            ksyscall_trace_read();
+            break;
+        case SYSCALL_PROF_CTL:
+            ksyscall_prof_ctl();
+            break;
+        case SYSCALL_PROF_READ:
+            ksyscall_prof_read();
+            break;
         case SYSCALL_MSG_SEND:
             ksyscall_msg_send();
             break;
         case SYSCALL_MSG_RECV:
             ksyscall_msg_recv();
             break;
+        case SYSCALL_MSG_SELECT:
+            ksyscall_msg_select();
+            break;
+        case SYSCALL_MBOX_CREATE:
+            ksyscall_mbox_create();
+            break;
+        case SYSCALL_HANDLE_DESTROY:
+            ksyscall_handle_destroy();
+            break;
+        case SYSCALL_IPC_CALL:
+            ksyscall_ipc_call();
+            break;
+        case SYSCALL_IPC_REPLY_WAIT:
+            ksyscall_ipc_reply_wait();
+            break;
+        case SYSCALL_CHAN_CREATE:
+            ksyscall_chan_create();
+            break;
+        case SYSCALL_CHAN_SUBSCRIBE:
+            ksyscall_chan_subscribe();
+            break;
+        case SYSCALL_CHAN_UNSUBSCRIBE:
+            ksyscall_chan_unsubscribe();
+            break;
+        case SYSCALL_CHAN_PUBLISH:
+            ksyscall_chan_publish();
+            break;
+        case SYSCALL_CHAN_RECV:
+            ksyscall_chan_recv();
+            break;
+        case SYSCALL_FUTEX_WAIT:
+            ksyscall_futex_wait();
+            break;
+        case SYSCALL_FUTEX_WAKE:
+            ksyscall_futex_wake();
+            break;
         default:
             panic("Bad switch cases in KISR.c\n");
             break;
     }
 }
 
+/**
+ * Registers the deferred work of the interrupt handlers
+ */
+void kisr_init() {
+    timer_work = kwork_register("timer", kisr_timer_work);
+
+    if (kirq_register(IRQ_TIMER, "timer", kisr_timer) != 0) {
+        panic("Unable to register the timer IRQ");
+    }
+}
+
 /**
  * Kernel Interrupt Service Routine: Timer (IRQ 0)
+ * Counts the tick and leaves the rest to kisr_timer_work()
+ * @param  irq - IRQ line (IRQ_TIMER)
  */
-void kisr_timer() {
+void kisr_timer(int irq) {
     // Increment the system time
-    int tempPid = 0;
-    int sleep_size = sleep_q.size;
-    system_time += 1;
-    while (sleep_size--){
-        if (dequeue(&sleep_q, &tempPid) != 0) {
-            panic("Error retrieving process from sleep queue");
-        }
-        // check to see if process needs to be woken up
-
-        // syntax to pull wake_time
-        if (pcb[tempPid].wake_time <= system_time){ //still sleeping
-            if (enqueue(pcb[tempPid].queue, tempPid) != 0) {
-                panic("Error adding process to its run queue");
-            }
-            pcb[tempPid].state = READY;
-        }
+    kclock_tick();
+    timer_ticks++;
 
-        if (pcb[tempPid].wake_time > system_time)
-        {
-            if (enqueue(&sleep_q, tempPid) != 0) {
-                panic("Error adding process to its sleep queue");
-            }
-        }
-    }
-    // check to see if PID == 0 (run_q vs idle_q)
+    // Sample whatever the tick interrupted
+    kprof_sample(kirq_frame());
 
+    kwork_raise(timer_work);
+}
 
-    // If the running PID is invalid, just return
-    // Since this is a hardware driven interrupt, make sure
-    // to dismiss the IRQ
-    if (run_pid >= 0 && run_pid < PROC_MAX)
-    {
+/**
+ * Deferred work for the timer: wakes sleepers, fires interval timers and
+ * charges the ticks to the running process, preempting it at the end of
+ * its quantum
+ */
+void kisr_timer_work() {
+    int ticks;
+    int flags;
+
+    flags = irq_save();
+    ticks = timer_ticks;
+    timer_ticks = 0;
+    irq_restore(flags);
+
+    // Wake sleeping processes whose time has come; the sleep queue is
+    // sorted so only the expired entries at its head are looked at
+    kclock_expire();
+
+    // Post messages for interval timers that have expired
+    ktimer_expire();
+
+    // Once the running process has used up its quantum it goes to the
+    // back of its run queue
+    if (run_pid >= 0 && run_pid < PROC_MAX) {
+        pcb[run_pid].time += ticks;
 
-    // Increment the running process' current run time
-    // Once the running process has exceeded the maximum
-    // number of ticks, it needs to be unscheduled:
-    //   set the total run time
-    //   reset the current running time
-    //   set the state to ready
-    //   queue the process back into the running queue
-    //   clear the running pid
-        pcb[run_pid].time += 1;
-
-        if (pcb[run_pid].time >= PROC_TICKS_MAX){
-            pcb[run_pid].total_time += pcb[run_pid].time;
-            pcb[run_pid].time = 0;
+        // The scheduler charges the ticks when it switches the process out
+        if (pcb[run_pid].time >= proc_ticks_max) {
             pcb[run_pid].state = READY;
 
             enqueue(pcb[run_pid].queue, run_pid);
             run_pid = -1;
-            outportb(0x20, 0x60);
         }
+    }
+}
 
-    // Dismiss IRQ 0 (Timer)
+/**
+ * Handles an interrupt taken while the kernel was running deferred work
+ * Only the top half runs; it may raise work but must not touch processes.
+ * @param  trapframe - pointer to the interrupted kernel context
+ */
+void kisr_nested(trapframe_t *trapframe) {
+    if (trapframe->interrupt < IRQ_BASE || trapframe->interrupt >= IRQ_BASE + IRQ_MAX) {
+        panic("Invalid nested interrupt");
     }
-   // else
-   // {
-   //     outportb(0x20, 0x60);
-   //     return;
-   // }
-   outportb(0x20, 0x60);
+
+    kirq_dispatch(trapframe->interrupt - IRQ_BASE, trapframe);
 }
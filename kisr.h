@@ -31,8 +31,18 @@
  * Function declarations
  */
 
+#include "global.h"
+#include "trapframe.h"
+
+// Registers deferred work
+void kisr_init();
+
 // Timer ISR
-void kisr_timer();
+void kisr_timer(int irq);
+void kisr_timer_work();
+
+// Interrupt taken while running deferred work
+void kisr_nested(trapframe_t *trapframe);
 
 // Syscall ISR
 void kisr_syscall();
@@ -40,8 +50,8 @@ void kisr_syscall();
 /* Defined in kisr_entry.S */
 __BEGIN_DECLS
 
-// Kernel interrupt entries
-extern void kisr_entry_timer();
+// Kernel interrupt entries (IRQ entries are indexed by IRQ line)
+extern func_ptr_t kisr_entry_irq[];
 extern void kisr_entry_syscall();
 
 __END_DECLS
@@ -0,0 +1,175 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Keyboard Driver
+ *
+ * The IRQ 1 handler only moves scancodes from the controller into a ring
+ * buffer. Its deferred work translates them to keys. Kernel debug commands
+ * run first, so they still work while a process waits for a key; any other
+ * key goes to a process blocked in read_key() or is kept for the next one.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kirq.h"
+#include "kkbd.h"
+#include "kwork.h"
+#include "queue.h"
+#include "string.h"
+
+// Scancode set 1 to ASCII, without and with shift (0 = no character)
+static const char keymap[] =
+    "\0\0331234567890-=\b\tqwertyuiop[]\n\0asdfghjkl;'`\0\\zxcvbnm,./\0*\0 ";
+static const char keymap_shift[] =
+    "\0\033!@#$%^&*()_+\b\tQWERTYUIOP{}\n\0ASDFGHJKL:\"~\0|ZXCVBNM<>?\0*\0 ";
+
+#define SCAN_LSHIFT 0x2A
+#define SCAN_RSHIFT 0x36
+#define SCAN_RELEASE 0x80
+
+// Scancodes written by the IRQ handler and read by the deferred work;
+// each index is only written by one side
+static unsigned char scan_ring[KBD_SCAN_SIZE];
+static volatile unsigned int scan_head;
+static volatile unsigned int scan_tail;
+
+// Keys not yet read
+static char key_ring[KBD_KEY_SIZE];
+static int key_head;
+static int key_count;
+
+// Processes blocked in read_key()
+static queue_t key_wait_q;
+
+static int shift;
+static int kbd_work;
+
+/**
+ * Registers the keyboard IRQ and its deferred work
+ */
+void kkbd_init() {
+    scan_head = 0;
+    scan_tail = 0;
+    key_head = 0;
+    key_count = 0;
+    shift = 0;
+    sp_memset(&key_wait_q, 0, sizeof(queue_t));
+
+    kbd_work = kwork_register("keyboard", kkbd_work);
+
+    if (kirq_register(IRQ_KEYBOARD, "keyboard", kkbd_irq) != 0) {
+        panic("Unable to register the keyboard IRQ");
+    }
+}
+
+/**
+ * IRQ 1 handler: buffers the scancode
+ * @param  irq - IRQ line (IRQ_KEYBOARD)
+ */
+void kkbd_irq(int irq) {
+    unsigned char code;
+
+    if ((inportb(KBD_STATUS) & KBD_STATUS_FULL) == 0) {
+        return;
+    }
+
+    code = inportb(KBD_DATA);
+
+    // Drop the scancode if the deferred work has fallen this far behind
+    if (scan_head - scan_tail < KBD_SCAN_SIZE) {
+        scan_ring[scan_head % KBD_SCAN_SIZE] = code;
+        scan_head++;
+    }
+
+    kwork_raise(kbd_work);
+}
+
+/**
+ * Translates a scancode, tracking the shift keys
+ * @param  code - scancode
+ * @return the key, 0 if the scancode does not produce one
+ */
+static char kkbd_translate(unsigned char code) {
+    if (code == SCAN_LSHIFT || code == SCAN_RSHIFT) {
+        shift = 1;
+        return 0;
+    }
+    if (code == (SCAN_LSHIFT | SCAN_RELEASE) || code == (SCAN_RSHIFT | SCAN_RELEASE)) {
+        shift = 0;
+        return 0;
+    }
+    if ((code & SCAN_RELEASE) || code >= sizeof(keymap) - 1) {
+        return 0;
+    }
+
+    return shift ? keymap_shift[code] : keymap[code];
+}
+
+/**
+ * Runs a key as a debug command, delivers it to the first blocked reader
+ * or keeps it for later
+ * @param  key - the key pressed
+ */
+static void kkbd_deliver(char key) {
+    int pid;
+
+    if (kernel_command(key) == 0) {
+        return;
+    }
+
+    if (dequeue(&key_wait_q, &pid) == 0) {
+        pcb[pid].trapframe_p->ebx = key;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T ENQUEUE KEY READER TO RUN QUEUE");
+        }
+        return;
+    }
+
+    // Keep the most recent keys when the buffer is full
+    if (key_count == KBD_KEY_SIZE) {
+        key_head = (key_head + 1) % KBD_KEY_SIZE;
+        key_count--;
+    }
+    key_ring[(key_head + key_count) % KBD_KEY_SIZE] = key;
+    key_count++;
+}
+
+/**
+ * Keyboard deferred work: translates and delivers buffered scancodes
+ */
+void kkbd_work() {
+    char key;
+
+    while (scan_tail != scan_head) {
+        key = kkbd_translate(scan_ring[scan_tail % KBD_SCAN_SIZE]);
+        scan_tail++;
+
+        if (key != 0) {
+            kkbd_deliver(key);
+        }
+    }
+}
+
+/**
+ * Takes the next key pressed for a process, queueing the process to wait
+ * for one if none is buffered
+ * @param  pid - reading process
+ * @return the key, KSYSCALL_BLOCKED if the process has to wait
+ */
+int kkbd_read_key(int pid) {
+    char key;
+
+    if (key_count > 0) {
+        key = key_ring[key_head];
+        key_head = (key_head + 1) % KBD_KEY_SIZE;
+        key_count--;
+        return key;
+    }
+
+    if (enqueue(&key_wait_q, pid) != 0) {
+        panic("CAN'T ENQUEUE TO KEY WAIT QUEUE");
+    }
+    return KSYSCALL_BLOCKED;
+}
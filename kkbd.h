@@ -0,0 +1,31 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Keyboard Driver
+ */
+#ifndef KKBD_H
+#define KKBD_H
+
+// Keyboard controller ports
+#define KBD_DATA 0x60
+#define KBD_STATUS 0x64
+#define KBD_STATUS_FULL 0x01
+
+// Scancodes buffered between the IRQ handler and its deferred work
+// (must be a power of two)
+#define KBD_SCAN_SIZE 64
+
+// Keys buffered for read_key()
+#define KBD_KEY_SIZE 64
+
+/**
+ * Function declarations
+ */
+void kkbd_init();
+void kkbd_irq(int irq);
+void kkbd_work();
+int kkbd_read_key(int pid);
+
+#endif
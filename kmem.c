@@ -0,0 +1,98 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Memory Pool
+ *
+ * A fixed-size pool carved into KMEM_BLOCK_SIZE blocks. Allocations take
+ * the first run of free blocks that is large enough (first fit).
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kmem.h"
+#include "string.h"
+
+// Memory backing the pool
+static unsigned char kmem_pool[KMEM_POOL_SIZE];
+
+// Number of blocks in the allocation starting at each block (0 if free
+// or not the first block of an allocation)
+static int kmem_len[KMEM_BLOCKS];
+
+// Set to 1 for every block that is in use
+static unsigned char kmem_used[KMEM_BLOCKS];
+
+/**
+ * Initializes the memory pool so that every block is free
+ */
+void kmem_init() {
+    sp_memset(kmem_len, 0, sizeof(kmem_len));
+    sp_memset(kmem_used, 0, sizeof(kmem_used));
+}
+
+/**
+ * Allocates memory from the pool
+ * @param  size - number of bytes to allocate
+ * @return pointer to the zeroed memory; NULL if no run of free blocks
+ *         is large enough
+ */
+void *kmem_alloc(int size) {
+    int blocks;
+    int start;
+    int run = 0;
+    int i;
+
+    if (size <= 0) {
+        return NULL;
+    }
+
+    blocks = (size + KMEM_BLOCK_SIZE - 1) / KMEM_BLOCK_SIZE;
+
+    // Find the first run of free blocks that is long enough
+    for (i = 0; i < KMEM_BLOCKS; i++) {
+        if (kmem_used[i]) {
+            run = 0;
+            continue;
+        }
+
+        run++;
+
+        if (run == blocks) {
+            start = i - blocks + 1;
+            sp_memset(&kmem_used[start], 1, blocks);
+            kmem_len[start] = blocks;
+            sp_memset(&kmem_pool[start * KMEM_BLOCK_SIZE], 0, blocks * KMEM_BLOCK_SIZE);
+            return &kmem_pool[start * KMEM_BLOCK_SIZE];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns memory to the pool
+ * @param  ptr - pointer previously returned by kmem_alloc()
+ */
+void kmem_free(void *ptr) {
+    int start;
+    unsigned char *p = ptr;
+
+    if (p == NULL) {
+        return;
+    }
+
+    if (p < kmem_pool || p >= kmem_pool + KMEM_POOL_SIZE
+        || (p - kmem_pool) % KMEM_BLOCK_SIZE != 0) {
+        panic("Invalid pointer freed to kernel memory pool");
+    }
+
+    start = (p - kmem_pool) / KMEM_BLOCK_SIZE;
+
+    if (kmem_len[start] == 0) {
+        panic("Kernel memory freed twice");
+    }
+
+    sp_memset(&kmem_used[start], 0, kmem_len[start]);
+    kmem_len[start] = 0;
+}
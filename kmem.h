@@ -0,0 +1,27 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Memory Pool
+ */
+#ifndef KMEM_H
+#define KMEM_H
+
+// Total size of the kernel memory pool in bytes
+#define KMEM_POOL_SIZE (128 * 1024)
+
+// Allocation granularity in bytes
+#define KMEM_BLOCK_SIZE 64
+
+// Number of blocks in the pool
+#define KMEM_BLOCKS (KMEM_POOL_SIZE / KMEM_BLOCK_SIZE)
+
+/**
+ * Function declarations
+ */
+void kmem_init();
+void *kmem_alloc(int size);
+void kmem_free(void *ptr);
+
+#endif
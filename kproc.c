@@ -10,6 +10,15 @@
 #include "kproc.h"
 #include "queue.h"
 #include "string.h"
+#include "ksyscall.h"
+#include "khandle.h"
+#include "kclock.h"
+#include "kaio.h"
+#include "kcons.h"
+#include "ktrace.h"
+
+// Process that ran last, to trace switches
+static int sched_last = -1;
 
 /**
  * Process scheduler
@@ -28,22 +37,87 @@ void kproc_schedule() {
 
 
     //Add logic for if nothing is in run que, pull from idle.
-    if (run_pid >= 0) {
-        return;
+    int prio;
+
+    // The last process gave up the CPU, or handed it straight to another.
+    // Its next run starts a fresh quantum even if it is picked again.
+    if (sched_last >= 0 && run_pid != sched_last) {
+        pcb[sched_last].total_time += pcb[sched_last].time;
+        pcb[sched_last].time = 0;
+        pcb[sched_last].preempted = pcb[sched_last].state == READY;
     }
-    if (dequeue(&run_q, &run_pid) == 0) {
-        pcb[run_pid].state = RUNNING;
-    }else if(dequeue(&idle_q, &run_pid) == 0){
-	    pcb[run_pid].state = RUNNING;
-    } else {
-        panic("No tasks scheduled to run");
 
+    if (run_pid < 0) {
+        // Take the first process from the highest priority run queue
+        for (prio = PROC_PRIO_MAX - 1; prio >= 0; prio--) {
+            if (dequeue(&run_q[prio], &run_pid) == 0) {
+                break;
+            }
+        }
+        if (prio >= 0) {
+            pcb[run_pid].state = RUNNING;
+        }else if(dequeue(&idle_q, &run_pid) == 0){
+            pcb[run_pid].state = RUNNING;
+        } else {
+            panic("No tasks scheduled to run");
+
+        }
+
+        if (run_pid < 0 || run_pid > PID_MAX) {
+            panic("Invalid PID");
+        }
+        debug_printf("Scheduled process %s (pid=%d)\n", pcb[run_pid].name, run_pid);
     }
 
-    if (run_pid < 0 || run_pid > PID_MAX) {
-        panic("Invalid PID");
+    // Only a different process getting the CPU counts as a switch
+    if (run_pid != sched_last) {
+        if (sched_last >= 0) {
+            kproc_switch_out(sched_last);
+        }
+        kproc_switch_in(run_pid);
+        sched_last = run_pid;
     }
-    debug_printf("Scheduled process %s (pid=%d)\n", pcb[run_pid].name, run_pid);
+}
+
+/**
+ * Accounts for a process leaving the CPU to another process
+ * A process that was still ready was preempted; any other state means it
+ * blocked, slept or exited. The scheduler has already set preempted.
+ * @param pid   the process switched out
+ */
+void kproc_switch_out(int pid) {
+    unsigned long long now = kclock_ns();
+
+    pcb[pid].cpu_ns += now - pcb[pid].switch_ns;
+    pcb[pid].switch_ns = now;
+
+    if (pcb[pid].preempted) {
+        pcb[pid].involuntary++;
+    } else {
+        pcb[pid].voluntary++;
+    }
+
+    KTRACE(TRACE_SCHED, TRACE_EV_SCHED_OUT, pid, pcb[pid].state);
+}
+
+/**
+ * Accounts for a process getting the CPU
+ * The time since it last ran counts as waiting if it was preempted (or is
+ * new) and as blocked otherwise; a blocked process' time in the run queue
+ * after waking is not told apart.
+ * @param pid   the process switched in
+ */
+void kproc_switch_in(int pid) {
+    unsigned long long now = kclock_ns();
+
+    if (pcb[pid].preempted) {
+        pcb[pid].wait_ns += now - pcb[pid].switch_ns;
+    } else {
+        pcb[pid].blocked_ns += now - pcb[pid].switch_ns;
+    }
+    pcb[pid].switch_ns = now;
+
+    KTRACE(TRACE_SCHED, TRACE_EV_SCHED_IN, pid, 0);
 }
 
 /**
@@ -77,8 +151,13 @@ void kproc_exec(char *proc_name, void *proc_ptr, queue_t *queue) {
     pcb[pid].state = READY;
     pcb[pid].time = 0;
     pcb[pid].total_time = 0;
+    pcb[pid].preempted = 1;
+    pcb[pid].switch_ns = kclock_ns();
+    pcb[pid].blocked_on = -1;
+    pcb[pid].timer_slack_ns = TIMER_SLACK_DEFAULT_NS;
     sp_strncpy(pcb[pid].name, proc_name, PROC_NAME_LEN);
     sp_memset(stack[pid], 0, sizeof(stack[pid]));
+    kcons_reset(pid);
 
     // Allocate the trapframe data
     pcb[pid].trapframe_p = (trapframe_t *)&stack[pid][PROC_STACK_SIZE - sizeof(trapframe_t)];
@@ -99,7 +178,12 @@ void kproc_exec(char *proc_name, void *proc_ptr, queue_t *queue) {
 
     // Set the process run queue (supplied as argument)
     // Move the proces into the associated run queue
+    // The priority is the index of the run queue (idle tasks have 0)
     pcb[pid].queue = queue;
+    if (queue >= &run_q[0] && queue < &run_q[PROC_PRIO_MAX]) {
+        pcb[pid].priority = queue - run_q;
+    }
+    pcb[pid].base_priority = pcb[pid].priority;
     enqueue(pcb[pid].queue, pid);
     debug_printf("Started process %s (pid=%d)\n", pcb[pid].name, pid);
 }
@@ -121,6 +205,18 @@ void kproc_exit() {
     }
     else {
         debug_printf("Exiting process %s (pid=%d)\n", pcb[run_pid].name, run_pid);
+        // Fail any synchronous calls still waiting on this process
+        ipc_abort(run_pid);
+        // Hand any mutexes still held to their next waiters
+        mutex_release_all(run_pid);
+        // Let go of any reader-writer locks it still holds
+        rwlock_release_all(run_pid);
+        // Release unread broadcast messages held for this process
+        chan_unsubscribe_all(run_pid);
+        // Drop outstanding asynchronous I/O, which refers to its memory
+        kaio_reclaim(run_pid);
+        // Destroy the kernel objects this process created
+        khandle_reclaim(run_pid);
         // Change the state of the running process to AVAILABLE
         // Queue it back to the available queue
         pcb[run_pid].state = AVAILABLE;
@@ -133,6 +229,35 @@ void kproc_exit() {
 }
 
 
+/**
+ * Changes the effective priority of a process
+ * A ready process is moved to the run queue for its new priority.
+ * Processes that live on the idle queue keep running at idle priority.
+ * @param pid   the process to change
+ * @param prio  the new effective priority
+ */
+void kproc_set_priority(int pid, int prio) {
+    if (pid < 0 || pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+    if (prio < 0 || prio >= PROC_PRIO_MAX) {
+        panic("Invalid priority");
+    }
+    if (pcb[pid].queue == &idle_q || pcb[pid].priority == prio) {
+        return;
+    }
+
+    if (pcb[pid].state == READY) {
+        if (queue_remove(pcb[pid].queue, pid) != 0) {
+            panic("Ready process missing from its run queue");
+        }
+        enqueue(&run_q[prio], pid);
+    }
+
+    pcb[pid].priority = prio;
+    pcb[pid].queue = &run_q[prio];
+}
+
 /**
  * Kernel idle task
  */
@@ -9,14 +9,42 @@
 #define KPROC_H
 
 #ifndef ASSEMBLER
+#include "global.h"
 #include "queue.h"
 #include "trapframe.h"
 
+// Queue a process was found on by proc_snapshot()
+typedef enum {
+    PROC_Q_RUNNING,                 // on the CPU
+    PROC_Q_READY,                   // in a run queue
+    PROC_Q_IDLE,                    // in the idle queue
+    PROC_Q_SLEEP,                   // in the sleep queue
+    PROC_Q_WAIT                     // in the wait queue of a kernel object
+} proc_queue_e;
+
+// Process table entry, as returned by proc_snapshot()
+typedef struct proc_stat_t {
+    int pid;
+    char name[PROC_NAME_LEN+1];
+    int state;                      // state_t in kernel.h
+    int priority;                   // effective priority
+    int queue;                      // proc_queue_e
+    int cpu_ticks;                  // timer ticks run
+    unsigned int cpu_us;            // run time
+    unsigned int wait_us;           // time ready but preempted
+    unsigned int blocked_us;        // time off the CPU after giving it up
+    int voluntary;                  // times it gave up the CPU
+    int involuntary;                // times it was preempted
+} proc_stat_t;
+
 // Kernel process functions
 void kproc_schedule();
 void kproc_load(trapframe_t *trapframe);
 void kproc_exec(char *proc_name, void *func_ptr, queue_t *queue);
 void kproc_exit();
+void kproc_set_priority(int pid, int prio);
+void kproc_switch_out(int pid);
+void kproc_switch_in(int pid);
 
 // Kernel tasks
 void ktask_idle();
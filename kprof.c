@@ -0,0 +1,95 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Sampling Profiler
+ *
+ * While enabled, every timer interrupt records the interrupted process and
+ * instruction. prof_read() drains the samples for tools/profsym.py, which
+ * resolves them against the kernel image.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kprof.h"
+#include "string.h"
+
+int kprof_enabled;
+
+static prof_sample_t prof_ring[PROF_SAMPLES];
+
+// Samples taken and samples read; head - tail never exceeds PROF_SAMPLES
+static unsigned int prof_head;
+static unsigned int prof_tail;
+
+/**
+ * Initializes the profiler (disabled)
+ */
+void kprof_init() {
+    kprof_enabled = 0;
+    prof_head = 0;
+    prof_tail = 0;
+}
+
+/**
+ * Records a sample; called from the timer IRQ handler
+ * @param  trapframe - state the timer interrupted
+ */
+void kprof_sample(trapframe_t *trapframe) {
+    prof_sample_t *s;
+
+    if (!kprof_enabled || trapframe == NULL) {
+        return;
+    }
+
+    s = &prof_ring[prof_head & (PROF_SAMPLES - 1)];
+    prof_head++;
+    if (prof_head - prof_tail > PROF_SAMPLES) {
+        prof_tail++;
+    }
+
+    // Only a process' own trapframe is saved in its PCB; anything else
+    // interrupted the kernel's deferred work
+    if (run_pid >= 0 && trapframe == pcb[run_pid].trapframe_p) {
+        s->pid = run_pid;
+    } else {
+        s->pid = PROF_PID_KERNEL;
+    }
+    s->eip = trapframe->eip;
+}
+
+/**
+ * Starts or stops sampling
+ * @param  enable - 1 to start, 0 to stop, or -1 to leave it unchanged
+ * @return whether sampling was enabled
+ */
+int kprof_ctl(int enable) {
+    int prev = kprof_enabled;
+
+    if (enable != -1) {
+        kprof_enabled = enable != 0;
+    }
+
+    return prev;
+}
+
+/**
+ * Moves the oldest samples into a buffer
+ * @param  buf - destination buffer
+ * @param  max - number of samples buf can hold
+ * @return number of samples stored, or -1 if max is negative
+ */
+int kprof_read(prof_sample_t *buf, int max) {
+    int count;
+
+    if (max < 0) {
+        return -1;
+    }
+
+    for (count = 0; count < max && prof_tail != prof_head; count++) {
+        buf[count] = prof_ring[prof_tail & (PROF_SAMPLES - 1)];
+        prof_tail++;
+    }
+
+    return count;
+}
@@ -0,0 +1,37 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Sampling Profiler
+ */
+#ifndef KPROF_H
+#define KPROF_H
+
+#include "trapframe.h"
+
+// Samples kept until read (must be a power of two); the oldest are
+// overwritten once it is full
+#define PROF_SAMPLES 4096
+
+// Process of samples taken while the kernel was running deferred work
+#define PROF_PID_KERNEL -1
+
+// Sample, as returned by prof_read()
+typedef struct prof_sample_t {
+    int pid;                        // Interrupted process, or PROF_PID_KERNEL
+    unsigned int eip;               // Interrupted instruction
+} prof_sample_t;
+
+// Set while samples are being taken
+extern int kprof_enabled;
+
+/**
+ * Function declarations
+ */
+void kprof_init();
+void kprof_sample(trapframe_t *trapframe);
+int kprof_ctl(int enable);
+int kprof_read(prof_sample_t *buf, int max);
+
+#endif
@@ -0,0 +1,289 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Serial Port Driver (16550 UART on COM1)
+ *
+ * The IRQ 4 handler moves bytes between the UART FIFOs and the receive and
+ * transmit rings. Each ring has one producer and one consumer: the IRQ
+ * handler fills the receive ring and empties the transmit ring, while the
+ * system calls and deferred work do the opposite, so the rings need no
+ * locks. Processes waiting on the rings are woken by the deferred work.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kirq.h"
+#include "kserial.h"
+#include "kwork.h"
+#include "queue.h"
+#include "string.h"
+
+// Pending transfer of a waiting process
+typedef struct serial_req_t {
+    char *buf;                      // Caller's buffer
+    int len;                        // Bytes still to transfer
+    int done;                       // Bytes transferred so far
+} serial_req_t;
+
+static unsigned char rx_ring[SERIAL_RX_SIZE];
+static volatile unsigned int rx_head;
+static volatile unsigned int rx_tail;
+static int rx_overruns;
+
+static unsigned char tx_ring[SERIAL_TX_SIZE];
+static volatile unsigned int tx_head;
+static volatile unsigned int tx_tail;
+
+// Interrupts currently enabled at the UART
+static volatile int serial_ier;
+
+// Processes waiting to read or write
+static queue_t rx_wait_q;
+static queue_t tx_wait_q;
+static serial_req_t serial_req[PROC_MAX];
+
+static int serial_work;
+
+/**
+ * Programs the UART and registers its IRQ and deferred work
+ */
+void kserial_init() {
+    int divisor = UART_CLOCK / SERIAL_BAUD;
+
+    rx_head = rx_tail = 0;
+    tx_head = tx_tail = 0;
+    rx_overruns = 0;
+    sp_memset(&rx_wait_q, 0, sizeof(queue_t));
+    sp_memset(&tx_wait_q, 0, sizeof(queue_t));
+    sp_memset(serial_req, 0, sizeof(serial_req));
+
+    outportb(COM1_BASE + UART_IER, 0);
+    outportb(COM1_BASE + UART_LCR, UART_LCR_DLAB);
+    outportb(COM1_BASE + UART_DLL, divisor & 0xFF);
+    outportb(COM1_BASE + UART_DLM, (divisor >> 8) & 0xFF);
+    outportb(COM1_BASE + UART_LCR, UART_LCR_8N1);
+    outportb(COM1_BASE + UART_FCR, UART_FCR_INIT);
+    outportb(COM1_BASE + UART_MCR, UART_MCR_INIT);
+
+    // Discard anything left over from before the reset
+    while (inportb(COM1_BASE + UART_LSR) & UART_LSR_RX) {
+        inportb(COM1_BASE + UART_DATA);
+    }
+    inportb(COM1_BASE + UART_IIR);
+    inportb(COM1_BASE + UART_MSR);
+
+    // Transmit interrupts are only enabled while there is data to send
+    serial_ier = UART_IER_RX | UART_IER_LINE;
+    outportb(COM1_BASE + UART_IER, serial_ier);
+
+    serial_work = kwork_register("serial", kserial_work);
+
+    if (kirq_register(IRQ_COM1, "com1", kserial_irq) != 0) {
+        panic("Unable to register the serial IRQ");
+    }
+}
+
+/**
+ * Enables the transmit interrupt; the UART raises it at once if the
+ * transmit holding register is already empty
+ */
+static void kserial_tx_start() {
+    int flags = irq_save();
+
+    if (!(serial_ier & UART_IER_TX)) {
+        serial_ier |= UART_IER_TX;
+        outportb(COM1_BASE + UART_IER, serial_ier);
+    }
+
+    irq_restore(flags);
+}
+
+/**
+ * IRQ 4 handler: drains the receive FIFO and refills the transmit FIFO
+ * @param  irq - IRQ line (IRQ_COM1)
+ */
+void kserial_irq(int irq) {
+    unsigned char iir;
+    int i;
+
+    while (!((iir = inportb(COM1_BASE + UART_IIR)) & UART_IIR_NONE)) {
+        switch (iir & UART_IIR_MASK) {
+            case UART_IIR_RX:
+            case UART_IIR_TIMEOUT:
+                while (inportb(COM1_BASE + UART_LSR) & UART_LSR_RX) {
+                    if (rx_head - rx_tail < SERIAL_RX_SIZE) {
+                        rx_ring[rx_head % SERIAL_RX_SIZE] = inportb(COM1_BASE + UART_DATA);
+                        rx_head++;
+                    } else {
+                        inportb(COM1_BASE + UART_DATA);
+                        rx_overruns++;
+                    }
+                }
+                break;
+
+            case UART_IIR_TX:
+                for (i = 0; i < UART_TX_FIFO && tx_tail != tx_head; i++) {
+                    outportb(COM1_BASE + UART_DATA, tx_ring[tx_tail % SERIAL_TX_SIZE]);
+                    tx_tail++;
+                }
+
+                if (tx_tail == tx_head) {
+                    serial_ier &= ~UART_IER_TX;
+                    outportb(COM1_BASE + UART_IER, serial_ier);
+                }
+                break;
+
+            case UART_IIR_LINE:
+                inportb(COM1_BASE + UART_LSR);
+                break;
+
+            case UART_IIR_MODEM:
+                inportb(COM1_BASE + UART_MSR);
+                break;
+        }
+    }
+
+    kwork_raise(serial_work);
+}
+
+/**
+ * Copies received bytes into a request
+ * @param  req - request to fill
+ */
+static void kserial_rx_copy(serial_req_t *req) {
+    while (req->len > 0 && rx_tail != rx_head) {
+        req->buf[req->done] = rx_ring[rx_tail % SERIAL_RX_SIZE];
+        rx_tail++;
+        req->done++;
+        req->len--;
+    }
+}
+
+/**
+ * Copies bytes from a request into the transmit ring
+ * @param  req - request to send
+ */
+static void kserial_tx_copy(serial_req_t *req) {
+    int copied = 0;
+
+    while (req->len > 0 && tx_head - tx_tail < SERIAL_TX_SIZE) {
+        tx_ring[tx_head % SERIAL_TX_SIZE] = req->buf[req->done];
+        tx_head++;
+        req->done++;
+        req->len--;
+        copied = 1;
+    }
+
+    if (copied) {
+        kserial_tx_start();
+    }
+}
+
+/**
+ * Makes a waiting process ready with the bytes it transferred
+ * @param  pid - process to wake
+ */
+static void kserial_wake(int pid) {
+    pcb[pid].trapframe_p->ebx = serial_req[pid].done;
+    pcb[pid].state = READY;
+    if (enqueue(pcb[pid].queue, pid) != 0) {
+        panic("CAN'T ENQUEUE SERIAL WAITER TO RUN QUEUE");
+    }
+}
+
+/**
+ * Serial deferred work: completes waiting reads and writes in order
+ */
+void kserial_work() {
+    int pid;
+
+    // A reader is done once it has received anything
+    while (rx_tail != rx_head && dequeue(&rx_wait_q, &pid) == 0) {
+        kserial_rx_copy(&serial_req[pid]);
+        kserial_wake(pid);
+    }
+
+    // A writer is done once all of its data is in the ring
+    while (tx_head - tx_tail < SERIAL_TX_SIZE && tx_wait_q.size > 0) {
+        pid = tx_wait_q.items[tx_wait_q.head];
+        kserial_tx_copy(&serial_req[pid]);
+        if (serial_req[pid].len > 0) {
+            break;
+        }
+        dequeue(&tx_wait_q, &pid);
+        kserial_wake(pid);
+    }
+}
+
+/**
+ * Reads up to len bytes for a process, queueing it to wait for at least
+ * one unless SERIAL_NONBLOCK is set
+ * @param  pid   - reading process
+ * @param  buf   - destination buffer
+ * @param  len   - most bytes to read
+ * @param  flags - SERIAL_NONBLOCK or 0
+ * @return number of bytes read, -1 if len is negative, KSYSCALL_BLOCKED
+ *         if the process has to wait
+ */
+int kserial_read(int pid, char *buf, int len, int flags) {
+    serial_req_t *req = &serial_req[pid];
+
+    if (len < 0) {
+        return -1;
+    }
+
+    req->buf = buf;
+    req->len = len;
+    req->done = 0;
+
+    // Readers that are already waiting get the data first
+    if (rx_wait_q.size == 0) {
+        kserial_rx_copy(req);
+    }
+
+    if (req->done > 0 || req->len == 0 || (flags & SERIAL_NONBLOCK)) {
+        return req->done;
+    }
+
+    if (enqueue(&rx_wait_q, pid) != 0) {
+        panic("CAN'T ENQUEUE TO SERIAL READ QUEUE");
+    }
+    return KSYSCALL_BLOCKED;
+}
+
+/**
+ * Queues len bytes of a process for transmission, queueing the process to
+ * wait for room for all of them unless SERIAL_NONBLOCK is set
+ * @param  pid   - writing process
+ * @param  buf   - data to send
+ * @param  len   - number of bytes to send
+ * @param  flags - SERIAL_NONBLOCK or 0
+ * @return number of bytes queued, -1 if len is negative, KSYSCALL_BLOCKED
+ *         if the process has to wait
+ */
+int kserial_write(int pid, char *buf, int len, int flags) {
+    serial_req_t *req = &serial_req[pid];
+
+    if (len < 0) {
+        return -1;
+    }
+
+    req->buf = buf;
+    req->len = len;
+    req->done = 0;
+
+    // Keep writers in order behind any that are already waiting
+    if (tx_wait_q.size == 0) {
+        kserial_tx_copy(req);
+    }
+
+    if (req->len == 0 || (flags & SERIAL_NONBLOCK)) {
+        return req->done;
+    }
+
+    if (enqueue(&tx_wait_q, pid) != 0) {
+        panic("CAN'T ENQUEUE TO SERIAL WRITE QUEUE");
+    }
+    return KSYSCALL_BLOCKED;
+}
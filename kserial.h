@@ -0,0 +1,77 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Serial Port Driver (16550 UART on COM1)
+ */
+#ifndef KSERIAL_H
+#define KSERIAL_H
+
+// COM1 base port
+#define COM1_BASE 0x3F8
+
+// 16550 registers (offsets from the base port)
+#define UART_DATA 0         // receive buffer / transmit holding (DLAB=0)
+#define UART_IER 1          // interrupt enable (DLAB=0)
+#define UART_DLL 0          // divisor latch low (DLAB=1)
+#define UART_DLM 1          // divisor latch high (DLAB=1)
+#define UART_IIR 2          // interrupt identification (read)
+#define UART_FCR 2          // FIFO control (write)
+#define UART_LCR 3          // line control
+#define UART_MCR 4          // modem control
+#define UART_LSR 5          // line status
+#define UART_MSR 6          // modem status
+
+// Interrupt enable bits
+#define UART_IER_RX 0x01    // received data available
+#define UART_IER_TX 0x02    // transmit holding register empty
+#define UART_IER_LINE 0x04  // line status
+
+// Interrupt identification values
+#define UART_IIR_NONE 0x01  // no interrupt pending
+#define UART_IIR_MASK 0x0E
+#define UART_IIR_MODEM 0x00
+#define UART_IIR_TX 0x02
+#define UART_IIR_RX 0x04
+#define UART_IIR_LINE 0x06
+#define UART_IIR_TIMEOUT 0x0C
+
+// Line status bits
+#define UART_LSR_RX 0x01    // data ready
+#define UART_LSR_TX 0x20    // transmit holding register empty
+
+// Line settings: 8 data bits, no parity, 1 stop bit; DLAB selects the divisor
+#define UART_LCR_8N1 0x03
+#define UART_LCR_DLAB 0x80
+
+// Enable and clear the FIFOs, interrupting once 14 bytes are received
+#define UART_FCR_INIT 0xC7
+
+// DTR, RTS and OUT2 (OUT2 gates the interrupt line to the PIC)
+#define UART_MCR_INIT 0x0B
+
+// Bytes the transmit FIFO takes each time it empties
+#define UART_TX_FIFO 16
+
+// Baud rate and the UART's base clock
+#define SERIAL_BAUD 115200
+#define UART_CLOCK 115200
+
+// Ring buffer sizes (must be powers of two)
+#define SERIAL_RX_SIZE 1024
+#define SERIAL_TX_SIZE 1024
+
+// serial_read()/serial_write() flags
+#define SERIAL_NONBLOCK 0x1     // return at once rather than waiting
+
+/**
+ * Function declarations
+ */
+void kserial_init();
+void kserial_irq(int irq);
+void kserial_work();
+int kserial_read(int pid, char *buf, int len, int flags);
+int kserial_write(int pid, char *buf, int len, int flags);
+
+#endif
@@ -11,23 +11,59 @@
 #include "string.h"
 #include "queue.h"
 #include "ksyscall.h"
+#include "kmem.h"
+#include "khandle.h"
+#include "kclock.h"
+#include "ktimer.h"
+#include "kirq.h"
+#include "kkbd.h"
+#include "kcons.h"
+#include "kserial.h"
+#include "kbcache.h"
+#include "kfs.h"
+#include "kaio.h"
+#include "ktrace.h"
+#include "kprof.h"
 // add ipc.h and declare mailing queues
 
 #include "ipc.h"
-int mbox_enqueue(msg_t *msg, int mbox_num);
-int mbox_dequeue(msg_t *msg, int mbox_num);
+int select_scan(msg_select_t *sel);
+void select_wake(int pid);
+void ipc_transfer(int from_pid, int to_pid);
+int chan_lookup(int handle);
+void chan_store(int num, msg_t *msg, int sender);
+void chan_read(int num, int pid, msg_t *msg);
+void chan_release(int num, int pid);
+void chan_drop_oldest(int num);
+int futex_lookup(int *addr);
+void sem_block(int num, int timeout_ms);
+int sem_lookup(int handle);
+int mutex_lookup(int handle);
+void wait_q_flush(queue_t *q);
+void mutex_release(int num);
+void mutex_boost(int num, int prio);
+void mutex_restore(int pid);
+int cond_lookup(int handle);
+void cond_wake(int num);
+int rwlock_lookup(int handle);
+void rwlock_grant(int num, int after_writer);
+int event_lookup(int handle);
+int event_match(unsigned int flags, unsigned int mask, int mode);
+void chan_reclaim(int num);
 /**
  * System call kernel handler: get_sys_time
- * Returns the current system time (in seconds) --> ticks/CLK_TCK
+ * Returns the current system time (in seconds)
  */
 void ksyscall_get_sys_time() {
+    timespec_t now;
     // Don't do anything if the running PID is invalid
     if (run_pid < 0 || run_pid > PID_MAX) {
         panic("Invalid PID");
     }
     // Copy the system time from the kernel to the
     // eax register via the running process' trapframe
-    pcb[run_pid].trapframe_p->ebx = system_time/CLK_TCK;
+    kclock_gettime(&now);
+    pcb[run_pid].trapframe_p->ebx = now.tv_sec;
 }
 
 /**
@@ -79,192 +115,2613 @@ void ksyscall_get_proc_name() {
  * Puts the currently running process to sleep
  */
 void ksyscall_sleep() {
-    int calc_wake_value = 0;
+    unsigned long long wake_ns;
     // Don't do anything if the running PID is invalid
     if (run_pid < 0 || run_pid > PID_MAX) {
         panic("Invalid PID");
     }
     // Calculate the wake time for the currently running process
-    // Store this time in the pcb's wake_time member
-    calc_wake_value = system_time + CLK_TCK * pcb[run_pid].trapframe_p->ebx;
-    pcb[run_pid].wake_time = calc_wake_value;
+    wake_ns = kclock_ns() + (unsigned long long)pcb[run_pid].trapframe_p->ebx * NSEC_PER_SEC;
     // Move the currently running process to the sleep queue
-    enqueue(&sleep_q, run_pid);
+    kclock_sleep(run_pid, wake_ns);
     // Change the running process state to SLEEP
     pcb[run_pid].state = SLEEPING;
     // Clear the running PID so the process scheduler will run
     run_pid = -1;
 }
 
+/**
+ * System call kernel handler: clock_gettime
+ * Copies the time since boot, to the nanosecond, to the caller
+ */
+void ksyscall_clock_gettime() {
+    timespec_t *ts;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    ts = (timespec_t *)pcb[run_pid].trapframe_p->ebx;
+
+    if (ts == NULL) {
+        panic("TIMESPEC POINTER IS INVALID");
+    }
+
+    kclock_gettime(ts);
+}
+
+/**
+ * System call kernel handler: nanosleep
+ * Puts the running process to sleep for the requested interval. The
+ * process wakes on the first timer tick at or after its wake time.
+ * Returns 0 once the interval has passed, -1 if the interval is invalid
+ */
+void ksyscall_nanosleep() {
+    timespec_t *req;
+    unsigned long long wake_ns;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    req = (timespec_t *)pcb[run_pid].trapframe_p->ebx;
+
+    if (req == NULL) {
+        panic("TIMESPEC POINTER IS INVALID");
+    }
+    if (req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= NSEC_PER_SEC) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    pcb[run_pid].trapframe_p->ebx = 0;
+
+    wake_ns = kclock_ns() + (unsigned long long)req->tv_sec * NSEC_PER_SEC + req->tv_nsec;
+    kclock_sleep(run_pid, wake_ns);
+
+    pcb[run_pid].state = SLEEPING;
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: timer_create
+ * Creates a periodic timer that posts a message to a mailbox each time
+ * the period elapses
+ * Returns the timer handle, or -1 on error
+ */
+void ksyscall_timer_create() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = ktimer_create(pcb[run_pid].trapframe_p->ebx,
+                                                  pcb[run_pid].trapframe_p->ecx,
+                                                  run_pid);
+}
+
+/**
+ * System call kernel handler: set_tick_hz
+ * Changes the timer interrupt frequency. The scheduling quantum is kept
+ * at the same length in time.
+ * Returns 0 on success, -1 if the frequency is out of range
+ */
+void ksyscall_set_tick_hz() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kclock_set_hz(pcb[run_pid].trapframe_p->ebx);
+}
+
+/**
+ * System call kernel handler: set_timer_slack
+ * Sets how late (in microseconds) the running process' sleeps and
+ * timeouts may end so that they can share a wakeup with another process
+ * Returns 0 on success, -1 if the slack is out of range
+ */
+void ksyscall_set_timer_slack() {
+    int slack_us;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    slack_us = pcb[run_pid].trapframe_p->ebx;
+
+    if (slack_us < 0 || slack_us > TIMER_SLACK_MAX_US) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    pcb[run_pid].timer_slack_ns = slack_us * 1000;
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: irq_stats
+ * Copies the interrupt count and handler run time of an IRQ line
+ * Returns 0 on success, -1 if the line is invalid
+ */
+void ksyscall_irq_stats() {
+    irq_stats_t *stats;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    stats = (irq_stats_t *)pcb[run_pid].trapframe_p->ecx;
+
+    if (stats == NULL) {
+        panic("IRQ STATS POINTER IS INVALID");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kirq_stats(pcb[run_pid].trapframe_p->ebx, stats);
+}
+
+/**
+ * Returns a kernel service's result to the running process, or blocks the
+ * process if the service queued it to wait
+ * @param  rc - result, or KSYSCALL_BLOCKED
+ */
+static void ksyscall_return(int rc) {
+    if (rc == KSYSCALL_BLOCKED) {
+        pcb[run_pid].state = WAITING;
+        run_pid = -1;
+        return;
+    }
+
+    pcb[run_pid].trapframe_p->ebx = rc;
+}
+
+/**
+ * System call kernel handler: read_key
+ * Returns the next key pressed, waiting for one if none is buffered
+ */
+void ksyscall_read_key() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    ksyscall_return(kkbd_read_key(run_pid));
+}
+
+/**
+ * System call kernel handler: cons_write
+ * Buffers a record of console output for the console task
+ */
+void ksyscall_cons_write() {
+    char *record;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    record = (char *)pcb[run_pid].trapframe_p->ebx;
+
+    if (record == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kcons_write(run_pid, record, pcb[run_pid].trapframe_p->ecx);
+}
+
+/**
+ * System call kernel handler: cons_wait
+ * Blocks the console task until there is output to write
+ */
+void ksyscall_cons_wait() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    ksyscall_return(kcons_wait(run_pid));
+}
+
+/**
+ * System call kernel handler: serial_read
+ * Reads up to len bytes from COM1, waiting for at least one unless
+ * SERIAL_NONBLOCK is set
+ */
+void ksyscall_serial_read() {
+    char *buf;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (char *)pcb[run_pid].trapframe_p->ebx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    ksyscall_return(kserial_read(run_pid, buf, pcb[run_pid].trapframe_p->ecx,
+                                 pcb[run_pid].trapframe_p->edx));
+}
+
+/**
+ * System call kernel handler: serial_write
+ * Queues len bytes for COM1, waiting for room for all of them unless
+ * SERIAL_NONBLOCK is set
+ */
+void ksyscall_serial_write() {
+    char *buf;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (char *)pcb[run_pid].trapframe_p->ebx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    ksyscall_return(kserial_write(run_pid, buf, pcb[run_pid].trapframe_p->ecx,
+                                  pcb[run_pid].trapframe_p->edx));
+}
+
+/**
+ * Runs a single block read or write for the running process
+ * @param  op - BLK_OP_READ or BLK_OP_WRITE
+ */
+static void ksyscall_blk_rw(blk_op_e op) {
+    char *buf;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (char *)pcb[run_pid].trapframe_p->ecx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    ksyscall_return(kbcache_rw(run_pid, op, pcb[run_pid].trapframe_p->ebx, buf));
+}
+
+/**
+ * System call kernel handler: blk_read
+ * Copies a block into the caller's buffer
+ */
+void ksyscall_blk_read() {
+    ksyscall_blk_rw(BLK_OP_READ);
+}
+
+/**
+ * System call kernel handler: blk_write
+ * Copies the caller's buffer into a cached block to be written back later
+ */
+void ksyscall_blk_write() {
+    ksyscall_blk_rw(BLK_OP_WRITE);
+}
+
+/**
+ * System call kernel handler: blk_sync
+ * Writes every dirty block back, returning once they are on disk
+ */
+void ksyscall_blk_sync() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    ksyscall_return(kbcache_rw(run_pid, BLK_OP_SYNC, 0, NULL));
+}
+
+/**
+ * System call kernel handler: fs_open
+ * Opens a file by name, returning a handle to it
+ */
+void ksyscall_fs_open() {
+    char *name;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    name = (char *)pcb[run_pid].trapframe_p->ebx;
+
+    if (name == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kfs_open(name, pcb[run_pid].trapframe_p->ecx, run_pid);
+}
+
+/**
+ * System call kernel handler: fs_read
+ * Reads from the current position of an open file
+ */
+void ksyscall_fs_read() {
+    char *buf;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (char *)pcb[run_pid].trapframe_p->ecx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kfs_read(pcb[run_pid].trapframe_p->ebx, buf,
+                                             pcb[run_pid].trapframe_p->edx);
+}
+
+/**
+ * System call kernel handler: fs_write
+ * Writes at the current position of an open file
+ */
+void ksyscall_fs_write() {
+    char *buf;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (char *)pcb[run_pid].trapframe_p->ecx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kfs_write(pcb[run_pid].trapframe_p->ebx, buf,
+                                              pcb[run_pid].trapframe_p->edx);
+}
+
+/**
+ * System call kernel handler: fs_mmap
+ * Returns the address of part of a file's contents, 0 on error
+ */
+void ksyscall_fs_mmap() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = (int)kfs_mmap(pcb[run_pid].trapframe_p->ebx,
+                                                  pcb[run_pid].trapframe_p->ecx,
+                                                  pcb[run_pid].trapframe_p->edx);
+}
+
+/**
+ * System call kernel handler: fs_unlink
+ * Removes a file by name
+ */
+void ksyscall_fs_unlink() {
+    char *name;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    name = (char *)pcb[run_pid].trapframe_p->ebx;
+
+    if (name == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kfs_unlink(name);
+}
+
+/**
+ * System call kernel handler: aio_submit
+ * Starts an asynchronous operation whose completion is posted to a mailbox
+ */
+void ksyscall_aio_submit() {
+    aio_req_t *req;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    req = (aio_req_t *)pcb[run_pid].trapframe_p->ebx;
+
+    if (req == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kaio_submit(req, run_pid);
+}
+
+/**
+ * System call kernel handler: trace_ctl
+ * Sets the enabled categories (unless passed -1) and returns the previous
+ * ones
+ */
+void ksyscall_trace_ctl() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = ktrace_ctl(pcb[run_pid].trapframe_p->ebx);
+}
+
+/**
+ * System call kernel handler: trace_read
+ * Moves the oldest events into the caller's buffer
+ */
+void ksyscall_trace_read() {
+    trace_event_t *buf;
+    int max;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (trace_event_t *)pcb[run_pid].trapframe_p->ebx;
+    max = pcb[run_pid].trapframe_p->ecx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = ktrace_read(buf, max);
+}
+
+/**
+ * System call kernel handler: prof_ctl
+ * Starts (1) or stops (0) sampling, or leaves it unchanged (-1); returns
+ * whether sampling was enabled
+ */
+void ksyscall_prof_ctl() {
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kprof_ctl(pcb[run_pid].trapframe_p->ebx);
+}
+
+/**
+ * System call kernel handler: prof_read
+ * Moves the oldest samples into the caller's buffer
+ */
+void ksyscall_prof_read() {
+    prof_sample_t *buf;
+    int max;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("Invalid PID");
+    }
+
+    buf = (prof_sample_t *)pcb[run_pid].trapframe_p->ebx;
+    max = pcb[run_pid].trapframe_p->ecx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = kprof_read(buf, max);
+}
+
 void ksyscall_sem_init() {
 	int num;
+	int value;
+	
+	int *sem_pointer;
+	//check for valid pid
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	//check if initialized if not then will set it and gets semaphore id
+	sem_pointer = (int *)pcb[run_pid].trapframe_p->ebx;
+	value = pcb[run_pid].trapframe_p->ecx;
+
+	if(value < 0){
+		panic("SEMAPHORE VALUE IS INVALID");
+	}
+	
+	//reuse a live semaphore, otherwise allocate one and a handle for it
+	num = khandle_open(sem_pointer, HANDLE_SEMAPHORE, &semaphore_q);
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	//count is the number of permits available
+	semaphores[num].count = value;
+	semaphores[num].type = SEM_TYPE_COUNTING;
+	semaphores[num].owner = -1;
+	semaphores[num].init = SEMAPHORE_INITIALIZED;
+	pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+void ksyscall_sem_wait() {
+	int num;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	
+	num = sem_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+	
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	//take a permit if there is one, otherwise wait for a post
+	if(semaphores[num].count > 0) {
+		semaphores[num].count--;
+		pcb[run_pid].trapframe_p->ebx = 0;
+		return;
+	}
+	sem_block(num, 0);
+}
+
+void ksyscall_sem_trywait() {
+	int num;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	
+	num = sem_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+	
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	//never blocks: fail if there is no permit
+	if(semaphores[num].count > 0) {
+		semaphores[num].count--;
+		pcb[run_pid].trapframe_p->ebx = 0;
+	} else {
+		pcb[run_pid].trapframe_p->ebx = -1;
+	}
+}
+
+void ksyscall_sem_timedwait() {
+	int num;
+	int timeout;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	
+	num = sem_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+	timeout = pcb[run_pid].trapframe_p->ecx;
+	
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	if(semaphores[num].count > 0) {
+		semaphores[num].count--;
+		pcb[run_pid].trapframe_p->ebx = 0;
+		return;
+	}
+	//deadline already passed
+	if(timeout <= 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	sem_block(num, timeout);
+}
+
+/**
+ * Blocks the running process on a semaphore
+ * With a timeout the process also goes on the sleep queue; kisr_timer()
+ * pulls it off the semaphore's wait queue with a -1 result if the
+ * deadline passes before a post hands it a permit.
+ * @param  num        - semaphore identifier
+ * @param  timeout_ms - timeout in milliseconds, 0 to wait forever
+ */
+void sem_block(int num, int timeout_ms) {
+	KTRACE(TRACE_IPC, TRACE_EV_SEM_BLOCK, run_pid, num);
+
+	if(enqueue(&semaphores[num].wait_q, run_pid) != 0){
+		panic("CAN'T PROCESS QUEUE");
+	}
+
+	if(timeout_ms > 0){
+		pcb[run_pid].timeout_q = &semaphores[num].wait_q;
+		kclock_sleep(run_pid, kclock_ns() + (unsigned long long)timeout_ms * NSEC_PER_MSEC);
+	}
+
+	pcb[run_pid].state = WAITING;
+	run_pid = -1;
+}
+
+void ksyscall_sem_post() {
+	int num;
+	int i;
+	int pid = -1;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+
+	num = sem_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+	
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	pcb[run_pid].trapframe_p->ebx = 0;
+	//hand the permit to the first process blocked in sem_wait,
+	//skipping over processes that are only selecting on it
+	for(i = 0; i < semaphores[num].wait_q.size; i++){
+		pid = semaphores[num].wait_q.items[(semaphores[num].wait_q.head + i) % QUEUE_SIZE];
+		if(pcb[pid].select_p == NULL){
+			break;
+		}
+		pid = -1;
+	}
+	//move from wait to ready
+	if(pid >= 0){
+		if(queue_remove(&semaphores[num].wait_q, pid) != 0){
+			panic("DEQUEUE CAN'T PROCESS");
+		}
+		//a timed waiter no longer needs its timeout
+		if(pcb[pid].timeout_q != NULL){
+			queue_remove(&sleep_q, pid);
+			pcb[pid].timeout_q = NULL;
+		}
+		
+		if(enqueue(pcb[pid].queue, pid) != 0) {
+			panic("CAN'T PROCESS QUEUE");
+		}
+		
+		pcb[pid].trapframe_p->ebx = 0;
+		pcb[pid].state = READY;
+		KTRACE(TRACE_IPC, TRACE_EV_SEM_WAKE, pid, num);
+		return;
+	}
+	
+	//nobody waiting: keep the permit
+	semaphores[num].count++;
+
+	//let one selecting process know a permit is available
+	if(semaphores[num].wait_q.size > 0){
+		if(dequeue(&semaphores[num].wait_q, &pid) != 0){
+			panic("DEQUEUE CAN'T PROCESS");
+		}
+		select_wake(pid);
+	}
+}
+
+void ksyscall_mutex_init() {
+	int num;
+	int *sem_pointer;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	//mutexes share the semaphore table and identifiers
+	sem_pointer = (int *)pcb[run_pid].trapframe_p->ebx;
+
+	num = khandle_open(sem_pointer, HANDLE_MUTEX, &semaphore_q);
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	semaphores[num].count = 0;
+	semaphores[num].type = SEM_TYPE_MUTEX;
+	semaphores[num].owner = -1;
+	semaphores[num].init = SEMAPHORE_INITIALIZED;
+	pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: mutex_lock
+ * Takes the mutex or waits for it. While waiting, the owner (and whoever
+ * that owner is waiting on, and so on) runs at no less than the waiter's
+ * priority.
+ * Returns 0 on success, -1 if the mutex is invalid or already held by
+ * the caller
+ */
+void ksyscall_mutex_lock() {
+    int num;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = mutex_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0 || semaphores[num].owner == run_pid) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    pcb[run_pid].trapframe_p->ebx = 0;
+
+    if (semaphores[num].owner < 0) {
+        semaphores[num].owner = run_pid;
+        return;
+    }
+
+    if (enqueue(&semaphores[num].wait_q, run_pid) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+    pcb[run_pid].blocked_on = num;
+    pcb[run_pid].state = WAITING;
+
+    mutex_boost(num, pcb[run_pid].priority);
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: mutex_unlock
+ * Hands the mutex to its highest priority waiter and drops any priority
+ * the caller inherited through it
+ * Returns 0 on success, -1 if the caller does not own the mutex
+ */
+void ksyscall_mutex_unlock() {
+    int num;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = mutex_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0 || semaphores[num].owner != run_pid) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    mutex_release(num);
+    mutex_restore(run_pid);
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: set_proc_prio
+ * Sets the running process' own priority; any inherited priority that is
+ * higher stays in effect until the mutexes involved are released
+ */
+void ksyscall_set_proc_prio() {
+    int prio;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    prio = pcb[run_pid].trapframe_p->ebx;
+
+    if (prio < 0 || prio >= PROC_PRIO_MAX || pcb[run_pid].queue == &idle_q) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    pcb[run_pid].base_priority = prio;
+    mutex_restore(run_pid);
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * Converts nanoseconds to microseconds
+ * @param  ns - time in nanoseconds
+ * @return time in microseconds
+ */
+static unsigned int ns_to_us(unsigned long long ns) {
+    kclock_div(&ns, 1000);
+    return (unsigned int)ns;
+}
+
+/**
+ * System call kernel handler: proc_snapshot
+ * Copies every process table entry in use; nothing else runs in the
+ * kernel meanwhile, so the entries are consistent with each other. The
+ * caller's own entry includes the run in progress.
+ */
+void ksyscall_proc_snapshot() {
+    proc_stat_t *buf;
+    proc_stat_t *stat;
+    unsigned long long cpu_ns;
+    int max;
+    int count;
+    int pid;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    buf = (proc_stat_t *)pcb[run_pid].trapframe_p->ebx;
+    max = pcb[run_pid].trapframe_p->ecx;
+
+    if (buf == NULL) {
+        panic("NULL POINTER");
+    }
+    if (max < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    count = 0;
+    for (pid = 0; pid < PROC_MAX && count < max; pid++) {
+        if (pcb[pid].state == AVAILABLE) {
+            continue;
+        }
+
+        stat = &buf[count++];
+        stat->pid = pid;
+        sp_strncpy(stat->name, pcb[pid].name, PROC_NAME_LEN);
+        stat->name[PROC_NAME_LEN] = '\0';
+        stat->state = pcb[pid].state;
+        stat->priority = pcb[pid].priority;
+        stat->cpu_ticks = pcb[pid].total_time + pcb[pid].time;
+        stat->voluntary = pcb[pid].voluntary;
+        stat->involuntary = pcb[pid].involuntary;
+
+        cpu_ns = pcb[pid].cpu_ns;
+        if (pid == run_pid) {
+            cpu_ns += kclock_ns() - pcb[pid].switch_ns;
+        }
+        stat->cpu_us = ns_to_us(cpu_ns);
+        stat->wait_us = ns_to_us(pcb[pid].wait_ns);
+        stat->blocked_us = ns_to_us(pcb[pid].blocked_ns);
+
+        if (pcb[pid].state == RUNNING) {
+            stat->queue = PROC_Q_RUNNING;
+        } else if (pcb[pid].state == SLEEPING) {
+            stat->queue = PROC_Q_SLEEP;
+        } else if (pcb[pid].state == WAITING) {
+            stat->queue = PROC_Q_WAIT;
+        } else if (pcb[pid].queue == &idle_q) {
+            stat->queue = PROC_Q_IDLE;
+        } else {
+            stat->queue = PROC_Q_READY;
+        }
+    }
+
+    pcb[run_pid].trapframe_p->ebx = count;
+}
+
+/**
+ * Resolves a semaphore handle
+ * @param  handle - semaphore handle
+ * @return the semaphore table index; -1 if the handle is stale or unknown
+ */
+int sem_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_SEMAPHORE);
+}
+
+/**
+ * Resolves a mutex handle
+ * @param  handle - mutex handle
+ * @return the semaphore table index; -1 if the handle is stale or unknown
+ */
+int mutex_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_MUTEX);
+}
+
+/**
+ * Releases a semaphore or mutex table entry once its handle is destroyed
+ * Waiters are woken with an error; if the mutex was held, the owner drops
+ * any priority it inherited through it.
+ * @param  num - semaphore table index
+ */
+void sem_free(int num) {
+    int owner = semaphores[num].owner;
+
+    wait_q_flush(&semaphores[num].wait_q);
+
+    semaphores[num].owner = -1;
+    semaphores[num].count = 0;
+    semaphores[num].init = 0;
+    semaphores[num].type = SEM_TYPE_COUNTING;
+    if (owner >= 0) {
+        mutex_restore(owner);
+    }
+
+    enqueue(&semaphore_q, num);
+}
+
+/**
+ * Wakes every process on a wait queue with a -1 result, as when the object
+ * they are blocked on is destroyed
+ * @param  q - the wait queue
+ */
+void wait_q_flush(queue_t *q) {
+    int pid;
+
+    while (dequeue(q, &pid) == 0) {
+        // A selecting process sees the destroyed entry as ready
+        if (pcb[pid].select_p != NULL) {
+            select_wake(pid);
+            continue;
+        }
+        if (pcb[pid].timeout_q != NULL) {
+            queue_remove(&sleep_q, pid);
+            pcb[pid].timeout_q = NULL;
+        }
+        pcb[pid].blocked_on = -1;
+        pcb[pid].trapframe_p->ebx = -1;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T PROCESS QUEUE");
+        }
+    }
+}
+
+/**
+ * Passes a mutex to its highest priority waiter (first come first served
+ * among equals), or unlocks it if nobody is waiting
+ * @param  num - mutex index
+ */
+void mutex_release(int num) {
+    semaphore_t *mtx = &semaphores[num];
+    int i;
+    int pid;
+    int next = -1;
+
+    for (i = 0; i < mtx->wait_q.size; i++) {
+        pid = mtx->wait_q.items[(mtx->wait_q.head + i) % QUEUE_SIZE];
+        if (next < 0 || pcb[pid].priority > pcb[next].priority) {
+            next = pid;
+        }
+    }
+
+    mtx->owner = next;
+
+    if (next < 0) {
+        return;
+    }
+
+    queue_remove(&mtx->wait_q, next);
+    pcb[next].blocked_on = -1;
+    pcb[next].trapframe_p->ebx = 0;
+    pcb[next].state = READY;
+    if (enqueue(pcb[next].queue, next) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+
+    // The new owner inherits from the waiters it now holds up
+    mutex_restore(next);
+}
+
+/**
+ * Raises the owner of a mutex to at least the given priority, following
+ * the chain of owners that are themselves waiting on mutexes
+ * @param  num  - mutex being waited on
+ * @param  prio - priority of the waiter
+ */
+void mutex_boost(int num, int prio) {
+    int owner;
+    int depth;
+
+    // A chain can be no longer than the number of processes
+    for (depth = 0; num >= 0 && depth < PROC_MAX; depth++) {
+        owner = semaphores[num].owner;
+
+        if (owner < 0 || pcb[owner].priority >= prio) {
+            break;
+        }
+
+        kproc_set_priority(owner, prio);
+        num = pcb[owner].blocked_on;
+    }
+}
+
+/**
+ * Recomputes a process' effective priority as the higher of its own
+ * priority and that of any process waiting on a mutex it owns
+ * @param  pid - process to update
+ */
+void mutex_restore(int pid) {
+    int prio = pcb[pid].base_priority;
+    int num;
+    int i;
+    int waiter;
+
+    if (pcb[pid].queue == &idle_q) {
+        return;
+    }
+
+    for (num = 0; num < SEMAPHORE_MAX; num++) {
+        if (semaphores[num].type != SEM_TYPE_MUTEX || semaphores[num].owner != pid) {
+            continue;
+        }
+        for (i = 0; i < semaphores[num].wait_q.size; i++) {
+            waiter = semaphores[num].wait_q.items[(semaphores[num].wait_q.head + i) % QUEUE_SIZE];
+            if (pcb[waiter].priority > prio) {
+                prio = pcb[waiter].priority;
+            }
+        }
+    }
+
+    kproc_set_priority(pid, prio);
+}
+
+/**
+ * Releases every mutex held by a process
+ * @param  pid - the exiting process
+ */
+void mutex_release_all(int pid) {
+    int num;
+
+    for (num = 0; num < SEMAPHORE_MAX; num++) {
+        if (semaphores[num].type == SEM_TYPE_MUTEX && semaphores[num].owner == pid) {
+            mutex_release(num);
+        }
+    }
+}
+
+void ksyscall_cond_init() {
+	int num;
+	int *cond_pointer;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	cond_pointer = (int *)pcb[run_pid].trapframe_p->ebx;
+
+	num = khandle_open(cond_pointer, HANDLE_COND, &condition_q);
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	conditions[num].init = SEMAPHORE_INITIALIZED;
+	pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: cond_wait
+ * Releases the mutex and waits for the condition in one step, so a
+ * signal sent after the mutex is released cannot be missed. The mutex
+ * is held again when the call returns.
+ * Returns 0 on success, -1 if the caller does not own the mutex
+ */
+void ksyscall_cond_wait() {
+    int num;
+    int mtx;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = cond_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+    mtx = mutex_lookup(*(int *)pcb[run_pid].trapframe_p->ecx);
+
+    if (num < 0 || mtx < 0 || semaphores[mtx].owner != run_pid) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    if (enqueue(&conditions[num].wait_q, run_pid) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+    pcb[run_pid].cond_mutex = *(int *)pcb[run_pid].trapframe_p->ecx;
+    pcb[run_pid].trapframe_p->ebx = 0;
+    pcb[run_pid].state = WAITING;
+
+    mutex_release(mtx);
+    mutex_restore(run_pid);
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: cond_signal
+ * Wakes one process waiting on the condition
+ */
+void ksyscall_cond_signal() {
+    int num;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = cond_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    if (conditions[num].wait_q.size > 0) {
+        cond_wake(num);
+    }
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: cond_broadcast
+ * Wakes every process waiting on the condition
+ */
+void ksyscall_cond_broadcast() {
+    int num;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = cond_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    while (conditions[num].wait_q.size > 0) {
+        cond_wake(num);
+    }
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * Resolves a condition variable handle
+ * @param  handle - condition variable handle
+ * @return the condition table index; -1 if the handle is stale or unknown
+ */
+int cond_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_COND);
+}
+
+/**
+ * Releases a condition table entry once its handle is destroyed
+ * Waiters are woken with an error and without the mutex.
+ * @param  num - condition table index
+ */
+void cond_free(int num) {
+    wait_q_flush(&conditions[num].wait_q);
+    conditions[num].init = 0;
+    enqueue(&condition_q, num);
+}
+
+/**
+ * Moves the first waiter of a condition over to its mutex
+ * The waiter runs straight away if the mutex is free; otherwise it queues
+ * on the mutex (raising the owner's priority) instead of waking up only to
+ * block again.
+ * @param  num - condition table index
+ */
+void cond_wake(int num) {
+    int pid;
+    int mtx;
+
+    if (dequeue(&conditions[num].wait_q, &pid) != 0) {
+        panic("DEQUEUE CAN'T PROCESS");
+    }
+
+    mtx = mutex_lookup(pcb[pid].cond_mutex);
+
+    // The mutex was destroyed while the process waited
+    if (mtx < 0) {
+        pcb[pid].trapframe_p->ebx = -1;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T PROCESS QUEUE");
+        }
+        return;
+    }
+
+    if (semaphores[mtx].owner < 0) {
+        semaphores[mtx].owner = pid;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T PROCESS QUEUE");
+        }
+        return;
+    }
+
+    if (enqueue(&semaphores[mtx].wait_q, pid) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+    pcb[pid].blocked_on = mtx;
+    mutex_boost(mtx, pcb[pid].priority);
+}
+
+void ksyscall_rwlock_init() {
+	int num;
+	int *rwlock_pointer;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	rwlock_pointer = (int *)pcb[run_pid].trapframe_p->ebx;
+
+	num = khandle_open(rwlock_pointer, HANDLE_RWLOCK, &rwlock_q);
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	rwlocks[num].readers = 0;
+	sp_memset(rwlocks[num].read_holds, 0, sizeof(rwlocks[num].read_holds));
+	rwlocks[num].writer = -1;
+	rwlocks[num].init = SEMAPHORE_INITIALIZED;
+	pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: rwlock_rdlock
+ * Takes a shared read lock. Any number of readers may hold the lock at
+ * once; new readers wait while a writer holds or is waiting for it so
+ * that writers are not starved.
+ * Returns 0 on success, -1 if the lock is invalid
+ */
+void ksyscall_rwlock_rdlock() {
+    int num;
+    readwrite_lock_t *rw;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = rwlock_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    rw = &rwlocks[num];
+    pcb[run_pid].trapframe_p->ebx = 0;
+
+    if (rw->writer < 0 && rw->write_q.size == 0) {
+        rw->readers++;
+        rw->read_holds[run_pid]++;
+        return;
+    }
+
+    if (enqueue(&rw->read_q, run_pid) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+    pcb[run_pid].state = WAITING;
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: rwlock_wrlock
+ * Takes the exclusive write lock
+ * Returns 0 on success, -1 if the lock is invalid or already held by
+ * the caller
+ */
+void ksyscall_rwlock_wrlock() {
+    int num;
+    readwrite_lock_t *rw;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = rwlock_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0 || rwlocks[num].writer == run_pid) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    rw = &rwlocks[num];
+    pcb[run_pid].trapframe_p->ebx = 0;
+
+    if (rw->writer < 0 && rw->readers == 0) {
+        rw->writer = run_pid;
+        return;
+    }
+
+    if (enqueue(&rw->write_q, run_pid) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+    pcb[run_pid].state = WAITING;
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: rwlock_unlock
+ * Releases a read or write lock held by the caller
+ * Returns 0 on success, -1 if the caller holds no lock
+ */
+void ksyscall_rwlock_unlock() {
+    int num;
+    readwrite_lock_t *rw;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = rwlock_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    rw = &rwlocks[num];
+
+    if (rw->writer == run_pid) {
+        rw->writer = -1;
+        rwlock_grant(num, 1);
+    } else if (rw->read_holds[run_pid] > 0) {
+        rw->read_holds[run_pid]--;
+        rw->readers--;
+        rwlock_grant(num, 0);
+    } else {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * Resolves a reader-writer lock handle
+ * @param  handle - reader-writer lock handle
+ * @return the lock table index; -1 if the handle is stale or unknown
+ */
+int rwlock_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_RWLOCK);
+}
+
+/**
+ * Releases a reader-writer lock table entry once its handle is destroyed
+ * Waiting readers and writers are woken with an error.
+ * @param  num - lock table index
+ */
+void rwlock_free(int num) {
+    wait_q_flush(&rwlocks[num].read_q);
+    wait_q_flush(&rwlocks[num].write_q);
+    rwlocks[num].readers = 0;
+    sp_memset(rwlocks[num].read_holds, 0, sizeof(rwlocks[num].read_holds));
+    rwlocks[num].writer = -1;
+    rwlocks[num].init = 0;
+    enqueue(&rwlock_q, num);
+}
+
+/**
+ * Hands a released reader-writer lock to its waiters
+ * Waiting readers are all let in together after a writer; otherwise a
+ * waiting writer gets the lock once the last reader leaves.
+ * @param  num          - reader-writer lock table index
+ * @param  after_writer - 1 if a writer just released the lock
+ */
+void rwlock_grant(int num, int after_writer) {
+    readwrite_lock_t *rw = &rwlocks[num];
+    int pid;
+
+    if (rw->writer >= 0 || rw->readers > 0) {
+        return;
+    }
+
+    if (!(after_writer && rw->read_q.size > 0) && dequeue(&rw->write_q, &pid) == 0) {
+        rw->writer = pid;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T PROCESS QUEUE");
+        }
+        return;
+    }
+
+    while (dequeue(&rw->read_q, &pid) == 0) {
+        rw->readers++;
+        rw->read_holds[pid]++;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T PROCESS QUEUE");
+        }
+    }
+}
+
+/**
+ * Releases every reader-writer lock held by a process
+ * @param  pid - the exiting process
+ */
+void rwlock_release_all(int pid) {
+    readwrite_lock_t *rw;
+    int num;
+
+    for (num = 0; num < RWLOCK_MAX; num++) {
+        rw = &rwlocks[num];
+        if (rw->init != SEMAPHORE_INITIALIZED) {
+            continue;
+        }
+
+        if (rw->writer == pid) {
+            rw->writer = -1;
+            rwlock_grant(num, 1);
+        } else if (rw->read_holds[pid] > 0) {
+            rw->readers -= rw->read_holds[pid];
+            rw->read_holds[pid] = 0;
+            rwlock_grant(num, 0);
+        }
+    }
+}
+
+void ksyscall_event_init() {
+	int num;
+	int *event_pointer;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+	event_pointer = (int *)pcb[run_pid].trapframe_p->ebx;
+
+	num = khandle_open(event_pointer, HANDLE_EVENT, &event_q);
+	if(num < 0){
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	events[num].flags = 0;
+	events[num].init = SEMAPHORE_INITIALIZED;
+	pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: event_set
+ * Sets flags and, in a single pass over the wait queue, wakes every waiter
+ * whose mask is now satisfied. Woken processes are appended to their run
+ * queues in one batch per queue.
+ * Returns the number of processes woken, -1 on error
+ */
+void ksyscall_event_set() {
+    int num;
+    int i;
+    int n;
+    int pid;
+    int size;
+    int prio;
+    int woken_count = 0;
+    int woken[PROC_MAX];
+    int batch[PROC_MAX];
+    unsigned int mask;
+    queue_t *queue;
+    event_group_t *ev;
+    trapframe_t *tf;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = event_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    ev = &events[num];
+    ev->flags |= pcb[run_pid].trapframe_p->ecx;
+
+    // Rotate through the wait queue once, pulling out satisfied waiters
+    size = ev->wait_q.size;
+    for (i = 0; i < size; i++) {
+        if (dequeue(&ev->wait_q, &pid) != 0) {
+            panic("DEQUEUE CAN'T PROCESS");
+        }
+
+        tf = pcb[pid].trapframe_p;
+
+        if (!event_match(ev->flags, tf->ecx, tf->edx)) {
+            enqueue(&ev->wait_q, pid);
+            continue;
+        }
+
+        // The flag word goes back in ecx once the mask is no longer needed
+        tf->ebx = 0;
+        mask = tf->ecx;
+        tf->ecx = ev->flags;
+        if (tf->edx & EVENT_WAIT_CLEAR) {
+            ev->flags &= ~mask;
+        }
+        pcb[pid].state = READY;
+        woken[woken_count++] = pid;
+    }
+
+    // Move the woken processes onto each run queue in one operation
+    for (prio = -1; prio < PROC_PRIO_MAX; prio++) {
+        queue = (prio < 0) ? &idle_q : &run_q[prio];
+        n = 0;
+        for (i = 0; i < woken_count; i++) {
+            if (pcb[woken[i]].queue == queue) {
+                batch[n++] = woken[i];
+            }
+        }
+        if (n > 0 && enqueue_batch(queue, batch, n) != 0) {
+            panic("CAN'T ENQUEUE EVENT WAITERS TO RUN QUEUE");
+        }
+    }
+
+    pcb[run_pid].trapframe_p->ebx = woken_count;
+}
+
+/**
+ * System call kernel handler: event_clear
+ * Clears flags
+ * Returns 0 on success, -1 on error
+ */
+void ksyscall_event_clear() {
+    int num;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = event_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    events[num].flags &= ~pcb[run_pid].trapframe_p->ecx;
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: event_wait
+ * Waits until any (or all) of the flags in the mask are set
+ * Returns 0 on success with the flag word that satisfied the wait in ecx,
+ * -1 on error
+ */
+void ksyscall_event_wait() {
+    int num;
+    unsigned int mask;
+    int mode;
+    event_group_t *ev;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    num = event_lookup(*(int *)pcb[run_pid].trapframe_p->ebx);
+    mask = pcb[run_pid].trapframe_p->ecx;
+    mode = pcb[run_pid].trapframe_p->edx;
+
+    if (num < 0 || mask == 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    ev = &events[num];
+
+    if (event_match(ev->flags, mask, mode)) {
+        pcb[run_pid].trapframe_p->ebx = 0;
+        pcb[run_pid].trapframe_p->ecx = ev->flags;
+        if (mode & EVENT_WAIT_CLEAR) {
+            ev->flags &= ~mask;
+        }
+        return;
+    }
+
+    if (enqueue(&ev->wait_q, run_pid) != 0) {
+        panic("CAN'T PROCESS QUEUE");
+    }
+    pcb[run_pid].state = WAITING;
+    run_pid = -1;
+}
+
+/**
+ * Resolves an event flag group handle
+ * @param  handle - event flag group handle
+ * @return the event table index; -1 if the handle is stale or unknown
+ */
+int event_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_EVENT);
+}
+
+/**
+ * Releases an event table entry once its handle is destroyed
+ * Waiters are woken with an error.
+ * @param  num - event table index
+ */
+void event_free(int num) {
+    wait_q_flush(&events[num].wait_q);
+    events[num].flags = 0;
+    events[num].init = 0;
+    enqueue(&event_q, num);
+}
+
+/**
+ * Checks whether a flag word satisfies a wait
+ * @param  flags - current flag word
+ * @param  mask  - flags waited for
+ * @param  mode  - EVENT_WAIT_ANY or EVENT_WAIT_ALL
+ * @return 1 if satisfied, 0 otherwise
+ */
+int event_match(unsigned int flags, unsigned int mask, int mode) {
+    if (mode & EVENT_WAIT_ALL) {
+        return (flags & mask) == mask;
+    }
+    return (flags & mask) != 0;
+}
+
+void ksyscall_msg_send() {
+	int num;
+	msg_t *msg_src = NULL;
+
+	if(run_pid < 0 || run_pid > PID_MAX){
+		panic("PID IS INVALID");
+	}
+
+	msg_src = (msg_t *)pcb[run_pid].trapframe_p->ebx;
+	num = mbox_lookup(pcb[run_pid].trapframe_p->ecx);
 	
-	int *sem_pointer;
-	//check for valid pid
+	if(msg_src == NULL){
+		panic("MAILBOX POINTER IS INVALID");
+	}
+	//stale or unknown mailbox handle
+	if(num < 0) {
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+	//fails if the mailbox is full
+	pcb[run_pid].trapframe_p->ebx = mbox_post(num, msg_src, run_pid);
+}
+
+/**
+ * Queues a message in a mailbox and hands it to the first waiting
+ * receiver, if any. Used by msg_send and by the kernel itself.
+ * @param  num    - mailbox index
+ * @param  msg    - message to queue
+ * @param  sender - value for the message's sender field
+ * @return 0 on success, -1 if the mailbox is full
+ */
+int mbox_post(int num, msg_t *msg, int sender) {
+    int waiting_pid;
+    msg_t *msg_dest;
+
+    if (mbox_enqueue(msg, num, sender) != 0) {
+        return -1;
+    }
+
+    if (dequeue(&mailboxes[num].wait_q, &waiting_pid) != 0) {
+        return 0;
+    }
+
+    // A selecting process receives the message itself once it runs
+    if (pcb[waiting_pid].select_p != NULL) {
+        select_wake(waiting_pid);
+        return 0;
+    }
+
+    if (enqueue(pcb[waiting_pid].queue, waiting_pid) != 0) {
+        panic("CAN'T ENQUEUE WATING PID TO RUN QUEUE");
+    }
+    pcb[waiting_pid].state = READY;
+
+    msg_dest = (msg_t *)pcb[waiting_pid].trapframe_p->ebx;
+    mbox_dequeue(msg_dest, num);
+    pcb[waiting_pid].trapframe_p->ebx = 0;
+    KTRACE(TRACE_IPC, TRACE_EV_MBOX_WAKE, waiting_pid, num);
+    return 0;
+}
+
+/**
+ * Holds back a free slot of a mailbox for a message that will be posted
+ * later, so that other senders cannot fill the mailbox in the meantime
+ * @param  num - mailbox index
+ * @return 0 on success, -1 if the mailbox has no slot left to reserve
+ */
+int mbox_reserve(int num) {
+    mailbox_t *mb = &mailboxes[num];
+
+    if (mb->size + mb->reserved >= mb->capacity) {
+        return -1;
+    }
+
+    mb->reserved++;
+    return 0;
+}
+
+/**
+ * Gives back a slot taken with mbox_reserve(), either to post the
+ * promised message into it or because it will never be sent
+ * @param  num - mailbox index
+ */
+void mbox_unreserve(int num) {
+    if (mailboxes[num].reserved <= 0) {
+        panic("MAILBOX HAS NO RESERVED SLOT");
+    }
+    mailboxes[num].reserved--;
+}
+
+void ksyscall_msg_recv() {
+	int num;	
+	msg_t *msg_dest = NULL;
+
 	if(run_pid < 0 || run_pid > PID_MAX){
 		panic("PID IS INVALID");
 	}
-	//check if initialized if not then will set it and gets semaphore id
-	sem_pointer = (int *)pcb[run_pid].trapframe_p->ebx;
+
+	msg_dest = (msg_t *)pcb[run_pid].trapframe_p->ebx;	
+	num = mbox_lookup(pcb[run_pid].trapframe_p->ecx);
+	
+	if(msg_dest == NULL){
+		panic("MAILBOX POINTER IS INVALID");
+	}
+	//stale or unknown mailbox handle
+	if(num < 0) {
+		pcb[run_pid].trapframe_p->ebx = -1;
+		return;
+	}
+
 	
-	if(*sem_pointer == SEMAPHORE_UNINITIALIZED){
+	//dequeue if there is message and if no message set to waiting
+	if(mailboxes[num].size > 0){
+		if(mbox_dequeue(msg_dest, num) !=0){
+			panic("MESSAGE CAN'T BE DEQUEUED");
+		}
+		pcb[run_pid].trapframe_p->ebx = 0;
+	} else{
+		if(enqueue(&mailboxes[num].wait_q, run_pid) != 0){
+			panic("CAN'T ENQUEUE TO WAIT QUEUE");
+		}
+		KTRACE(TRACE_IPC, TRACE_EV_MBOX_BLOCK, run_pid, num);
+		pcb[run_pid].state = WAITING;
+		//clear run pid so another process can be scheduled
+		run_pid = -1;	
+	}
+}
+
+/**
+ * System call kernel handler: mbox_create
+ * Creates a mailbox holding up to `capacity` messages of `msg_size` bytes
+ * of data each. Storage is allocated from the kernel memory pool.
+ * Returns the mailbox handle, or -1 on error
+ */
+void ksyscall_mbox_create() {
+    int capacity;
+    int msg_size;
+    int num;
+    int i;
+    int handle;
+    mailbox_t *mb;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    capacity = pcb[run_pid].trapframe_p->ebx;
+    msg_size = pcb[run_pid].trapframe_p->ecx;
+    pcb[run_pid].trapframe_p->ebx = -1;
+
+    if (capacity <= 0 || capacity > MBOX_CAPACITY_MAX
+        || msg_size <= 0 || msg_size > MSG_SIZE) {
+        return;
+    }
+
+    if (dequeue(&mailbox_q, &num) != 0) {
+        return;
+    }
+
+    mb = &mailboxes[num];
+    mb->storage = kmem_alloc(capacity * (MSG_HEADER_SIZE + msg_size));
+    mb->next = kmem_alloc(capacity * sizeof(int));
+    handle = khandle_alloc(HANDLE_MBOX, num, run_pid);
+
+    if (mb->storage == NULL || mb->next == NULL || handle < 0) {
+        kmem_free(mb->storage);
+        kmem_free(mb->next);
+        mb->storage = NULL;
+        mb->next = NULL;
+        if (handle >= 0) {
+            khandle_destroy(handle, HANDLE_MBOX);
+        } else {
+            enqueue(&mailbox_q, num);
+        }
+        return;
+    }
+
+    mb->in_use = 1;
+    mb->capacity = capacity;
+    mb->msg_size = msg_size;
+    mb->size = 0;
+    mb->reserved = 0;
+    mb->prio_mask = 0;
+
+    // Every slot starts out on the free list
+    for (i = 0; i < capacity; i++) {
+        mb->next[i] = i + 1;
+    }
+    mb->next[capacity - 1] = -1;
+    mb->free = 0;
+
+    for (i = 0; i < MSG_PRIO_MAX; i++) {
+        mb->head[i] = -1;
+        mb->tail[i] = -1;
+    }
+    sp_memset(&mb->wait_q, 0, sizeof(queue_t));
+
+    pcb[run_pid].trapframe_p->ebx = handle;
+}
+
+/**
+ * System call kernel handler: handle_destroy
+ * Destroys the kernel object a handle names and frees the handle.
+ * Processes blocked on the object are woken with an error.
+ * Returns 0 on success, -1 if the handle is stale or of another type
+ */
+void ksyscall_handle_destroy() {
+    int handle;
+    int type;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    handle = pcb[run_pid].trapframe_p->ebx;
+    type = pcb[run_pid].trapframe_p->ecx;
+
+    if (type == HANDLE_FREE) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+    pcb[run_pid].trapframe_p->ebx = khandle_destroy(handle, type);
+}
+
+/**
+ * Releases a mailbox once its handle is destroyed, discarding queued
+ * messages and its storage. Processes blocked on it are woken with an error.
+ * @param  num - mailbox index
+ */
+void mbox_free(int num) {
+    mailbox_t *mb = &mailboxes[num];
+
+    mb->in_use = 0;
+    wait_q_flush(&mb->wait_q);
+
+    kmem_free(mb->storage);
+    kmem_free(mb->next);
+    mb->storage = NULL;
+    mb->next = NULL;
+    mb->size = 0;
+
+    enqueue(&mailbox_q, num);
+}
+
+/**
+ * Resolves a mailbox handle to its index in the mailbox table
+ * @param  handle - mailbox handle returned by mbox_create
+ * @return mailbox index; -1 if the handle is stale or unknown
+ */
+int mbox_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_MBOX);
+}
+
+/**
+ * System call kernel handler: msg_select
+ * Waits until any mailbox or semaphore in the select set is ready.
+ * The selecting process is queued on the wait queue of every entry in the
+ * set; whichever entry becomes ready first wakes it and removes it from the
+ * others, so a send only ever wakes a single waiter.
+ */
+void ksyscall_msg_select() {
+    msg_select_t *sel;
+    int i;
+    int j;
+    int ready;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    sel = (msg_select_t *)pcb[run_pid].trapframe_p->ebx;
+
+    if (sel == NULL) {
+        panic("SELECT POINTER IS INVALID");
+    }
+    if (sel->mbox_count < 0 || sel->mbox_count > MSG_SELECT_MAX
+        || sel->sem_count < 0 || sel->sem_count > MSG_SELECT_MAX) {
+        panic("SELECT COUNT IS INVALID");
+    }
+    // Each entry must exist and appear once, since the caller waits on
+    // every wait queue in the set
+    for (i = 0; i < sel->mbox_count; i++) {
+        if (mbox_lookup(sel->mbox[i]) < 0) {
+            pcb[run_pid].trapframe_p->ebx = -1;
+            return;
+        }
+        for (j = 0; j < i; j++) {
+            if (mbox_lookup(sel->mbox[j]) == mbox_lookup(sel->mbox[i])) {
+                pcb[run_pid].trapframe_p->ebx = -1;
+                return;
+            }
+        }
+    }
+    for (i = 0; i < sel->sem_count; i++) {
+        if (sem_lookup(sel->sem[i]) < 0) {
+            pcb[run_pid].trapframe_p->ebx = -1;
+            return;
+        }
+        for (j = 0; j < i; j++) {
+            if (sem_lookup(sel->sem[j]) == sem_lookup(sel->sem[i])) {
+                pcb[run_pid].trapframe_p->ebx = -1;
+                return;
+            }
+        }
+    }
+
+    // Return immediately if anything is already ready
+    ready = select_scan(sel);
+    if (ready > 0 || (sel->mbox_count == 0 && sel->sem_count == 0)) {
+        pcb[run_pid].trapframe_p->ebx = ready;
+        return;
+    }
+
+    // Otherwise wait on every entry in the set
+    for (i = 0; i < sel->mbox_count; i++) {
+        if (enqueue(&mailboxes[mbox_lookup(sel->mbox[i])].wait_q, run_pid) != 0) {
+            panic("CAN'T ENQUEUE TO WAIT QUEUE");
+        }
+    }
+    for (i = 0; i < sel->sem_count; i++) {
+        if (enqueue(&semaphores[sem_lookup(sel->sem[i])].wait_q, run_pid) != 0) {
+            panic("CAN'T ENQUEUE TO WAIT QUEUE");
+        }
+    }
+
+    pcb[run_pid].select_p = sel;
+    pcb[run_pid].state = WAITING;
+    run_pid = -1;
+}
+
+/**
+ * Flags every ready mailbox and semaphore in a select set
+ * @param  sel - pointer to the select set
+ * @return number of ready entries
+ */
+int select_scan(msg_select_t *sel) {
+    int i;
+    int num;
+    int ready = 0;
+
+    for (i = 0; i < sel->mbox_count; i++) {
+        num = mbox_lookup(sel->mbox[i]);
+        // A destroyed mailbox reports ready so msg_recv() sees the error
+        sel->mbox_ready[i] = (num < 0 || mailboxes[num].size > 0);
+        ready += sel->mbox_ready[i];
+    }
+    for (i = 0; i < sel->sem_count; i++) {
+        num = sem_lookup(sel->sem[i]);
+        // Likewise a destroyed semaphore, so sem_trywait() sees the error
+        sel->sem_ready[i] = (num < 0 || semaphores[num].count > 0);
+        ready += sel->sem_ready[i];
+    }
+    return ready;
+}
+
+/**
+ * Wakes a process blocked in msg_select
+ * The process has already been removed from the wait queue that woke it;
+ * it is removed from the remaining wait queues in its select set.
+ * @param  pid - process to wake
+ */
+void select_wake(int pid) {
+    msg_select_t *sel = pcb[pid].select_p;
+    int i;
+    int num;
+
+    for (i = 0; i < sel->mbox_count; i++) {
+        num = mbox_lookup(sel->mbox[i]);
+        if (num >= 0) {
+            queue_remove(&mailboxes[num].wait_q, pid);
+        }
+    }
+    for (i = 0; i < sel->sem_count; i++) {
+        num = sem_lookup(sel->sem[i]);
+        if (num >= 0) {
+            queue_remove(&semaphores[num].wait_q, pid);
+        }
+    }
+
+    pcb[pid].trapframe_p->ebx = select_scan(sel);
+    pcb[pid].select_p = NULL;
+
+    if (enqueue(pcb[pid].queue, pid) != 0) {
+        panic("CAN'T ENQUEUE SELECTING PID TO RUN QUEUE");
+    }
+    pcb[pid].state = READY;
+}
+
+/**
+ * System call kernel handler: ipc_call
+ * Sends a register message to a server and blocks until it replies.
+ * If the server is already waiting in ipc_reply_wait the message is copied
+ * straight into its trapframe and the kernel switches to it directly
+ * without going through the run queue.
+ */
+void ksyscall_ipc_call() {
+    int server;
+    int client;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    client = run_pid;
+    server = pcb[client].trapframe_p->ebx;
+
+    if (server < 0 || server > PID_MAX || server == client
+        || pcb[server].state == AVAILABLE) {
+        pcb[client].trapframe_p->ebx = -1;
+        return;
+    }
+
+    pcb[client].ipc_partner = server;
+    pcb[client].state = WAITING;
+
+    if (pcb[server].ipc_state == IPC_RECEIVING) {
+        // Hand the message over and run the server in our place
+        ipc_transfer(client, server);
+        pcb[server].trapframe_p->ebx = client;
+        pcb[client].ipc_state = IPC_REPLY_WAIT;
+        pcb[server].ipc_state = IPC_NONE;
+        pcb[server].state = RUNNING;
+        run_pid = server;
+        return;
+    }
+
+    if (enqueue(&pcb[server].ipc_call_q, client) != 0) {
+        panic("CAN'T ENQUEUE TO IPC CALL QUEUE");
+    }
+    pcb[client].ipc_state = IPC_CALLING;
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: ipc_reply_wait
+ * Replies to a client (if one is given) and waits for the next call.
+ * When no call is pending the server blocks and the kernel switches
+ * directly to the client it just replied to.
+ */
+void ksyscall_ipc_reply_wait() {
+    int server;
+    int client;
+    int caller;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    server = run_pid;
+    client = pcb[server].trapframe_p->ebx;
+
+    // Deliver the reply
+    if (client >= 0) {
+        if (client > PID_MAX || pcb[client].ipc_state != IPC_REPLY_WAIT
+            || pcb[client].ipc_partner != server) {
+            pcb[server].trapframe_p->ebx = -1;
+            return;
+        }
+        ipc_transfer(server, client);
+        pcb[client].trapframe_p->ebx = 0;
+        pcb[client].ipc_state = IPC_NONE;
+    }
+
+    // Take the next pending call without blocking
+    if (dequeue(&pcb[server].ipc_call_q, &caller) == 0) {
+        ipc_transfer(caller, server);
+        pcb[server].trapframe_p->ebx = caller;
+        pcb[caller].ipc_state = IPC_REPLY_WAIT;
+
+        if (client >= 0) {
+            pcb[client].state = READY;
+            if (enqueue(pcb[client].queue, client) != 0) {
+                panic("CAN'T ENQUEUE CLIENT TO RUN QUEUE");
+            }
+        }
+        return;
+    }
+
+    // Nothing pending: wait for a call and run the client in our place
+    pcb[server].ipc_state = IPC_RECEIVING;
+    pcb[server].state = WAITING;
+
+    if (client >= 0) {
+        pcb[client].state = RUNNING;
+        run_pid = client;
+    } else {
+        run_pid = -1;
+    }
+}
 
-		if(dequeue(&semaphore_q, &num) != 0){
-			panic("CAN'T GET SEMAPHORE");
-		}
-		*sem_pointer = num;
-	} else {
-		num = *sem_pointer;
-	}
-	semaphores[num].count = 0;
-	semaphores[num].init = SEMAPHORE_INITIALIZED;
-	
+/**
+ * Copies the register message words from one process' trapframe to another
+ * The caller sets the receiver's return value (ebx) itself.
+ * @param  from_pid - sending process
+ * @param  to_pid   - receiving process
+ */
+void ipc_transfer(int from_pid, int to_pid) {
+    trapframe_t *from = pcb[from_pid].trapframe_p;
+    trapframe_t *to = pcb[to_pid].trapframe_p;
+
+    to->ecx = from->ecx;
+    to->edx = from->edx;
+    to->esi = from->esi;
+    to->edi = from->edi;
 }
 
-void ksyscall_sem_wait() {
-	int num;
+/**
+ * Fails every call outstanding against a server that is going away
+ * Clients queued on the server or waiting for its reply are woken with -1.
+ * @param  pid - the exiting server process
+ */
+void ipc_abort(int pid) {
+    int client;
 
-	if(run_pid < 0 || run_pid > PID_MAX){
-		panic("PID IS INVALID");
-	}
-	
-	num = *(int *)pcb[run_pid].trapframe_p->ebx;
-	
-	if(num < 0 || num > SEMAPHORE_MAX){
-		panic("SEMPAPHORE IS INVALID");
-	}
-	//sets process to waiting.. if there is one in wait queue it should be unscheduled
-	if(semaphores[num].count > 0) {
-		if(enqueue(&semaphores[num].wait_q, run_pid) != 0){
-			panic("CAN'T PROCESS QUEUE");
-		}
-		pcb[run_pid].state = WAITING;
-		run_pid = -1;
-	}
-	//increment everytime there is a call
-	semaphores[num].count++;
+    for (client = 0; client < PROC_MAX; client++) {
+        if (client == pid || pcb[client].ipc_partner != pid
+            || (pcb[client].ipc_state != IPC_CALLING
+                && pcb[client].ipc_state != IPC_REPLY_WAIT)) {
+            continue;
+        }
+
+        pcb[client].trapframe_p->ebx = -1;
+        pcb[client].ipc_state = IPC_NONE;
+        pcb[client].state = READY;
+        if (enqueue(pcb[client].queue, client) != 0) {
+            panic("CAN'T ENQUEUE CLIENT TO RUN QUEUE");
+        }
+    }
+
+    sp_memset(&pcb[pid].ipc_call_q, 0, sizeof(queue_t));
+    pcb[pid].ipc_state = IPC_NONE;
 }
 
-void ksyscall_sem_post() {
-	int num;
-	int pid = -1;
+/**
+ * System call kernel handler: chan_create
+ * Creates a broadcast channel with the given full-channel policy
+ * Returns the channel handle, or -1 on error
+ */
+void ksyscall_chan_create() {
+    int policy;
+    int num;
+    int i;
+    int handle;
+    channel_t *ch;
 
-	if(run_pid < 0 || run_pid > PID_MAX){
-		panic("PID IS INVALID");
-	}
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
 
-	num = *(int *)pcb[run_pid].trapframe_p->ebx;
-	
-	if(num < 0 || num > SEMAPHORE_MAX){
-		panic("SEMPAPHORE IS INVALID");
-	}
-	//move from wait to ready
-	if(semaphores[num].wait_q.size > 0){
-		if(dequeue(&semaphores[num].wait_q, &pid) != 0){
-			panic("DEQUEUE CAN'T PROCESS");
-		}
-		
-		if(enqueue(pcb[pid].queue, pid) != 0) {
-			panic("CAN'T PROCESS QUEUE");
-		}
-		
-		pcb[pid].state = READY;
-	}
-	
-	if(semaphores[num].count > 0) {
-		semaphores[num].count--;
-	}
+    policy = pcb[run_pid].trapframe_p->ebx;
+    pcb[run_pid].trapframe_p->ebx = -1;
+
+    if (policy != CHAN_DROP_OLDEST && policy != CHAN_BLOCK_PUBLISHER) {
+        return;
+    }
+    if (dequeue(&channel_q, &num) != 0) {
+        return;
+    }
+    handle = khandle_alloc(HANDLE_CHAN, num, run_pid);
+    if (handle < 0) {
+        enqueue(&channel_q, num);
+        return;
+    }
+
+    ch = &channels[num];
+    sp_memset(ch, 0, sizeof(channel_t));
+    ch->in_use = 1;
+    ch->policy = policy;
+    for (i = 0; i < PROC_MAX; i++) {
+        ch->cursor[i] = -1;
+    }
+
+    pcb[run_pid].trapframe_p->ebx = handle;
 }
 
-void ksyscall_msg_send() {
-	int num;
-	msg_t *msg_src = NULL;
-	msg_t *msg_dest = NULL;
+/**
+ * System call kernel handler: chan_subscribe
+ * Subscribes the running process to messages published from now on
+ * Returns 0 on success, -1 on error
+ */
+void ksyscall_chan_subscribe() {
+    int num;
+    channel_t *ch;
 
-	int waiting_pid = -1;
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
 
-	if(run_pid < 0 || run_pid > PID_MAX){
-		panic("PID IS INVALID");
-	}
+    num = chan_lookup(pcb[run_pid].trapframe_p->ebx);
+    pcb[run_pid].trapframe_p->ebx = -1;
 
-	msg_src = (msg_t *)pcb[run_pid].trapframe_p->ebx;
-	num = pcb[run_pid].trapframe_p->ecx;
-	
-	if(msg_src == NULL){
-		panic("MAILBOX POINTER IS INVALID");
-	}
-	if(num < 0 || num > MBOX_MAX) {
-		panic("MAILBOX IDENTIFIER IS INVALID");
-	}
-	
-	if(mbox_enqueue(msg_src, num) != 0){
-		panic("MAILBOX CAN'T UNQUEUE");
-	}
-	//dequeue from wait queue and set to ready
-	if(mailboxes[num].wait_q.size > 0) {
-		if(dequeue(&mailboxes[num].wait_q, &waiting_pid) != 0){
-			panic("WAITING PID CAN'T DEQUEUE");
-		}
-		if(enqueue(pcb[waiting_pid].queue, waiting_pid) != 0){
-			panic("CAN'T ENQUEUE WATING PID TO RUN QUEUE");
-		}
+    if (num < 0 || channels[num].cursor[run_pid] >= 0) {
+        return;
+    }
 
-		pcb[waiting_pid].state = READY;
-		//msg pointer then dequeue
-		msg_dest = (msg_t *)pcb[waiting_pid].trapframe_p->ebx;
-		
-		mbox_dequeue(msg_dest, num);
-	}	 
+    ch = &channels[num];
+    ch->cursor[run_pid] = ch->tail;
+    ch->subscribers++;
+
+    pcb[run_pid].trapframe_p->ebx = 0;
 }
 
-void ksyscall_msg_recv() {
-	int num;	
-	msg_t *msg_dest = NULL;
+/**
+ * System call kernel handler: chan_unsubscribe
+ * Unsubscribes the running process, releasing any messages it had not read
+ * Returns 0 on success, -1 on error
+ */
+void ksyscall_chan_unsubscribe() {
+    int num;
 
-	if(run_pid < 0 || run_pid > PID_MAX){
-		panic("PID IS INVALID");
-	}
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
 
-	msg_dest = (msg_t *)pcb[run_pid].trapframe_p->ebx;	
-	num = pcb[run_pid].trapframe_p->ecx;
-	
-	if(msg_dest == NULL){
-		panic("MAILBOX POINTER IS INVALID");
-	}
-	if(num < 0 || num > MBOX_MAX) {
-		panic("MAILBOX IDENTIFIER IS INVALID");
-	}
+    num = chan_lookup(pcb[run_pid].trapframe_p->ebx);
+    pcb[run_pid].trapframe_p->ebx = -1;
 
-	
-	//dequeue if there is message and if no message set to waiting
-	if(mailboxes[num].size > 0){
-		if(mbox_dequeue(msg_dest, num) !=0){
-			panic("MESSAGE CAN'T BE DEQUEUED");
-		}
-	} else{
-		if(enqueue(&mailboxes[num].wait_q, run_pid) != 0){
-			panic("CAN'T ENQUEUE TO WAIT QUEUE");
-		}
-		pcb[run_pid].state = WAITING;
-		//clear run pid so another process can be scheduled
-		run_pid = -1;	
-	}
-	
-	
+    if (num < 0 || channels[num].cursor[run_pid] < 0) {
+        return;
+    }
+
+    chan_release(num, run_pid);
+    chan_reclaim(num);
+
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: chan_publish
+ * Stores one copy of the message for every current subscriber. Waiting
+ * subscribers receive it immediately. When the channel is full the oldest
+ * message is dropped or the publisher blocks, depending on the policy.
+ * Returns 0 on success, -1 on error
+ */
+void ksyscall_chan_publish() {
+    int num;
+    msg_t *msg;
+    channel_t *ch;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    msg = (msg_t *)pcb[run_pid].trapframe_p->ebx;
+    num = chan_lookup(pcb[run_pid].trapframe_p->ecx);
+
+    if (msg == NULL) {
+        panic("MESSAGE POINTER IS INVALID");
+    }
+    if (num < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    ch = &channels[num];
+
+    // Nobody is listening
+    if (ch->subscribers == 0) {
+        pcb[run_pid].trapframe_p->ebx = 0;
+        return;
+    }
+
+    if (ch->tail - ch->head == CHAN_SIZE) {
+        if (ch->policy == CHAN_BLOCK_PUBLISHER) {
+            // Published on our behalf once a slot is freed
+            if (enqueue(&ch->pub_wait_q, run_pid) != 0) {
+                panic("CAN'T ENQUEUE TO PUBLISHER WAIT QUEUE");
+            }
+            pcb[run_pid].state = WAITING;
+            run_pid = -1;
+            return;
+        }
+
+        // Drop the oldest message; subscribers that had not read it skip it
+        chan_drop_oldest(num);
+    }
+
+    chan_store(num, msg, run_pid);
+    chan_reclaim(num);
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * System call kernel handler: chan_recv
+ * Receives the next message at the running process' cursor, blocking if
+ * it has read everything published so far
+ * Returns 0 on success, -1 on error
+ */
+void ksyscall_chan_recv() {
+    int num;
+    msg_t *msg;
+    channel_t *ch;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    msg = (msg_t *)pcb[run_pid].trapframe_p->ebx;
+    num = chan_lookup(pcb[run_pid].trapframe_p->ecx);
+
+    if (msg == NULL) {
+        panic("MESSAGE POINTER IS INVALID");
+    }
+    if (num < 0 || channels[num].cursor[run_pid] < 0) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    ch = &channels[num];
+
+    if (ch->cursor[run_pid] == ch->tail) {
+        if (enqueue(&ch->wait_q, run_pid) != 0) {
+            panic("CAN'T ENQUEUE TO WAIT QUEUE");
+        }
+        pcb[run_pid].state = WAITING;
+        run_pid = -1;
+        return;
+    }
+
+    chan_read(num, run_pid, msg);
+    chan_reclaim(num);
+    pcb[run_pid].trapframe_p->ebx = 0;
+}
+
+/**
+ * Resolves a channel handle
+ * @param  handle - channel handle returned by chan_create
+ * @return the channel identifier; -1 if the handle is stale or unknown
+ */
+int chan_lookup(int handle) {
+    return khandle_lookup(handle, HANDLE_CHAN);
+}
+
+/**
+ * Releases a channel once its handle is destroyed. Blocked subscribers
+ * and publishers are woken with an error.
+ * @param  num - channel identifier
+ */
+void chan_free(int num) {
+    channels[num].in_use = 0;
+    wait_q_flush(&channels[num].wait_q);
+    wait_q_flush(&channels[num].pub_wait_q);
+    enqueue(&channel_q, num);
+}
+
+/**
+ * Stores a message in the next free slot of a channel and hands it to
+ * every subscriber already waiting for it
+ * @param  num    - channel identifier
+ * @param  msg    - message to publish
+ * @param  sender - publishing process
+ */
+void chan_store(int num, msg_t *msg, int sender) {
+    channel_t *ch = &channels[num];
+    msg_t *slot = &ch->slots[ch->tail % CHAN_SIZE];
+    timespec_t now;
+    int pid;
+
+    sp_memcpy(slot, msg, sizeof(msg_t));
+    slot->sender = sender;
+    kclock_gettime(&now);
+    slot->time_sent = now.tv_sec;
+    slot->time_sent_nsec = now.tv_nsec;
+
+    ch->refs[ch->tail % CHAN_SIZE] = ch->subscribers;
+    ch->tail++;
+
+    while (dequeue(&ch->wait_q, &pid) == 0) {
+        chan_read(num, pid, (msg_t *)pcb[pid].trapframe_p->ebx);
+        pcb[pid].trapframe_p->ebx = 0;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T ENQUEUE SUBSCRIBER TO RUN QUEUE");
+        }
+    }
+}
+
+/**
+ * Copies the message at a subscriber's cursor and advances the cursor
+ * @param  num - channel identifier
+ * @param  pid - subscribing process
+ * @param  msg - destination message
+ */
+void chan_read(int num, int pid, msg_t *msg) {
+    channel_t *ch = &channels[num];
+    int seq = ch->cursor[pid];
+    timespec_t now;
+
+    sp_memcpy(msg, &ch->slots[seq % CHAN_SIZE], sizeof(msg_t));
+    kclock_gettime(&now);
+    msg->time_received = now.tv_sec;
+    msg->time_received_nsec = now.tv_nsec;
+
+    ch->refs[seq % CHAN_SIZE]--;
+    ch->cursor[pid] = seq + 1;
+}
+
+/**
+ * Drops the oldest message of a full channel
+ * Subscribers that had not read it move on to the next message.
+ * @param  num - channel identifier
+ */
+void chan_drop_oldest(int num) {
+    channel_t *ch = &channels[num];
+    int pid;
+
+    for (pid = 0; pid < PROC_MAX; pid++) {
+        if (ch->cursor[pid] == ch->head) {
+            ch->cursor[pid]++;
+        }
+    }
+    ch->refs[ch->head % CHAN_SIZE] = 0;
+    ch->head++;
+}
+
+/**
+ * Drops a subscriber's claim on every message it has not read and
+ * removes it from the channel
+ * @param  num - channel identifier
+ * @param  pid - subscribing process
+ */
+void chan_release(int num, int pid) {
+    channel_t *ch = &channels[num];
+    int seq;
+
+    for (seq = ch->cursor[pid]; seq < ch->tail; seq++) {
+        ch->refs[seq % CHAN_SIZE]--;
+    }
+    ch->cursor[pid] = -1;
+    ch->subscribers--;
+    queue_remove(&ch->wait_q, pid);
+}
+
+/**
+ * Frees slots every subscriber has read and completes publishes that
+ * were blocked waiting for space
+ * @param  num - channel identifier
+ */
+void chan_reclaim(int num) {
+    channel_t *ch = &channels[num];
+    int pid;
+
+    while (1) {
+        while (ch->head < ch->tail && ch->refs[ch->head % CHAN_SIZE] == 0) {
+            ch->head++;
+        }
+
+        if (ch->tail - ch->head == CHAN_SIZE) {
+            break;
+        }
+        if (dequeue(&ch->pub_wait_q, &pid) != 0) {
+            break;
+        }
+
+        if (ch->subscribers > 0) {
+            chan_store(num, (msg_t *)pcb[pid].trapframe_p->ebx, pid);
+        }
+        pcb[pid].trapframe_p->ebx = 0;
+        pcb[pid].state = READY;
+        if (enqueue(pcb[pid].queue, pid) != 0) {
+            panic("CAN'T ENQUEUE PUBLISHER TO RUN QUEUE");
+        }
+    }
+}
+
+/**
+ * Unsubscribes a process from every channel it is subscribed to
+ * @param  pid - the exiting process
+ */
+void chan_unsubscribe_all(int pid) {
+    int num;
+
+    for (num = 0; num < CHAN_MAX; num++) {
+        if (channels[num].in_use && channels[num].cursor[pid] >= 0) {
+            chan_release(num, pid);
+            chan_reclaim(num);
+        }
+    }
+}
+
+/**
+ * System call kernel handler: futex_wait
+ * Puts the running process to sleep on a user address, but only if the
+ * address still holds the expected value. The check and the sleep happen
+ * together in the kernel so a wake cannot be lost in between.
+ * Returns 0 once woken, -1 if the value had already changed
+ */
+void ksyscall_futex_wait() {
+    int *addr;
+    int expected;
+    int num;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
+
+    addr = (int *)pcb[run_pid].trapframe_p->ebx;
+    expected = pcb[run_pid].trapframe_p->ecx;
+
+    if (addr == NULL) {
+        panic("FUTEX ADDRESS IS INVALID");
+    }
+
+    if (*addr != expected) {
+        pcb[run_pid].trapframe_p->ebx = -1;
+        return;
+    }
+
+    num = futex_lookup(addr);
+
+    // Claim a free futex slot for a new address
+    if (num < 0) {
+        for (num = 0; num < FUTEX_MAX; num++) {
+            if (futexes[num].addr == NULL) {
+                break;
+            }
+        }
+        if (num == FUTEX_MAX) {
+            panic("NO FUTEX AVAILABLE");
+        }
+        futexes[num].addr = addr;
+        sp_memset(&futexes[num].wait_q, 0, sizeof(queue_t));
+    }
+
+    if (enqueue(&futexes[num].wait_q, run_pid) != 0) {
+        panic("CAN'T ENQUEUE TO FUTEX WAIT QUEUE");
+    }
+
+    pcb[run_pid].trapframe_p->ebx = 0;
+    pcb[run_pid].state = WAITING;
+    run_pid = -1;
+}
+
+/**
+ * System call kernel handler: futex_wake
+ * Wakes up to the given number of processes sleeping on a user address
+ * Returns the number of processes woken
+ */
+void ksyscall_futex_wake() {
+    int *addr;
+    int count;
+    int num;
+    int pid;
+    int woken = 0;
+
+    if (run_pid < 0 || run_pid > PID_MAX) {
+        panic("PID IS INVALID");
+    }
 
+    addr = (int *)pcb[run_pid].trapframe_p->ebx;
+    count = pcb[run_pid].trapframe_p->ecx;
+
+    num = futex_lookup(addr);
+
+    if (num >= 0) {
+        while (woken < count && dequeue(&futexes[num].wait_q, &pid) == 0) {
+            pcb[pid].state = READY;
+            if (enqueue(pcb[pid].queue, pid) != 0) {
+                panic("CAN'T ENQUEUE FUTEX WAITER TO RUN QUEUE");
+            }
+            woken++;
+        }
+
+        // Release the slot once nobody is left waiting
+        if (futexes[num].wait_q.size == 0) {
+            futexes[num].addr = NULL;
+        }
+    }
+
+    pcb[run_pid].trapframe_p->ebx = woken;
+}
+
+/**
+ * Finds the futex slot for a user address
+ * @param  addr - user address
+ * @return futex slot; -1 if nobody is waiting on the address
+ */
+int futex_lookup(int *addr) {
+    int num;
 
+    if (addr == NULL) {
+        return -1;
+    }
 
+    for (num = 0; num < FUTEX_MAX; num++) {
+        if (futexes[num].addr == addr) {
+            return num;
+        }
+    }
+    return -1;
 }
 
 //add the mailbox enqueue and dequeue works similar to queue.c
-int mbox_enqueue(msg_t *msg, int mbox_num) {
+//each slot holds the msg_t header followed by msg_size bytes of data
+//messages are delivered highest priority first, FIFO within a priority
+int mbox_enqueue(msg_t *msg, int mbox_num, int sender) {
 
 	mailbox_t *mb;
+	int slot;
+	int prio;
+	timespec_t now;
 	
 	if(msg == NULL){
 		panic("MESSAGE IS INVALID");
 	}
-	if(mbox_num < 0 || mbox_num > MBOX_MAX){
+	if(mbox_num < 0 || mbox_num >= MBOX_MAX){
 		panic("MAILBOX IDENTIFIER IS INVALID");
 	}
 	
@@ -272,21 +2729,43 @@ int mbox_enqueue(msg_t *msg, int mbox_num) {
 
 	mb = &mailboxes[mbox_num];
 
-	if(mb->size == MBOX_SIZE){
+	// Slots reserved for promised messages are not free to others
+	if(mb->free < 0 || mb->size + mb->reserved >= mb->capacity){
 		return -1;
 	}
 
-	msg->sender = run_pid;
+	//clamp the priority into range
+	prio = msg->priority;
+	if(prio < 0){
+		prio = 0;
+	}
+	if(prio >= MSG_PRIO_MAX){
+		prio = MSG_PRIO_MAX - 1;
+	}
+
+	msg->sender = sender;
+	msg->priority = prio;
 
-	msg->time_sent = (system_time / CLK_TCK);
-	
-	sp_memcpy(&mb->messages[mb->tail], msg, sizeof(msg_t));
+	kclock_gettime(&now);
+	msg->time_sent = now.tv_sec;
+	msg->time_sent_nsec = now.tv_nsec;
 
-	mb->tail++;
+	//take a slot off the free list
+	slot = mb->free;
+	mb->free = mb->next[slot];
+	
+	sp_memcpy(&mb->storage[slot * (MSG_HEADER_SIZE + mb->msg_size)], msg,
+	          MSG_HEADER_SIZE + mb->msg_size);
 
-	if(mb->tail == MBOX_SIZE){
-		mb->tail = 0;
+	//append it to the list for its priority
+	mb->next[slot] = -1;
+	if(mb->tail[prio] < 0){
+		mb->head[prio] = slot;
+	} else {
+		mb->next[mb->tail[prio]] = slot;
 	}
+	mb->tail[prio] = slot;
+	mb->prio_mask |= (1 << prio);
 
 	mb->size++;
 	return 0;
@@ -295,10 +2774,14 @@ int mbox_enqueue(msg_t *msg, int mbox_num) {
 int mbox_dequeue(msg_t *msg, int mbox_num){
 
 	mailbox_t *mb;
+	int slot;
+	int prio;
+	timespec_t now;
+
 	if(msg == NULL){
 		panic("MESSAGE IS INVALID");
 	}
-	if(mbox_num < 0 || mbox_num > MBOX_MAX){
+	if(mbox_num < 0 || mbox_num >= MBOX_MAX){
 		panic("MAILBOX IDENTIFIER IS INVALID");
 	}
 	
@@ -307,18 +2790,38 @@ int mbox_dequeue(msg_t *msg, int mbox_num){
 	if(mb->size == 0){
 		return -1;
 	}
-	sp_memcpy(msg, &mb->messages[mb->head], sizeof(msg_t));
 
-	mb->head++;
+	//find the highest priority with messages waiting
+	prio = MSG_PRIO_MAX - 1;
+	while((mb->prio_mask & (1 << prio)) == 0){
+		prio--;
+	}
 
-	if(mb->head == MBOX_SIZE){
-		mb->head = 0;
+	//unlink the oldest message of that priority
+	slot = mb->head[prio];
+	mb->head[prio] = mb->next[slot];
+	if(mb->head[prio] < 0){
+		mb->tail[prio] = -1;
+		mb->prio_mask &= ~(1 << prio);
 	}
+
+	sp_memcpy(msg, &mb->storage[slot * (MSG_HEADER_SIZE + mb->msg_size)],
+	          MSG_HEADER_SIZE + mb->msg_size);
+
+	//return the slot to the free list
+	mb->next[slot] = mb->free;
+	mb->free = slot;
 	mb->size--;
 
-	msg->time_received = (system_time / CLK_TCK);
+	kclock_gettime(&now);
+	msg->time_received = now.tv_sec;
+	msg->time_received_nsec = now.tv_nsec;
+
+	//report expiries that were folded into this timer message
+	if(msg->sender == MSG_SENDER_TIMER){
+		ktimer_received(msg);
+	}
 	
 	return 0;
 
 }
-
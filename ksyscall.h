@@ -17,12 +17,81 @@ void ksyscall_get_proc_name();
 
 /* Additional functionality */
 void ksyscall_sleep();
+void ksyscall_clock_gettime();
+void ksyscall_nanosleep();
+void ksyscall_timer_create();
+void ksyscall_set_tick_hz();
+void ksyscall_set_timer_slack();
+void ksyscall_irq_stats();
+void ksyscall_read_key();
+void ksyscall_cons_write();
+void ksyscall_cons_wait();
+void ksyscall_serial_read();
+void ksyscall_serial_write();
+void ksyscall_blk_read();
+void ksyscall_blk_write();
+void ksyscall_blk_sync();
+void ksyscall_fs_open();
+void ksyscall_fs_read();
+void ksyscall_fs_write();
+void ksyscall_fs_mmap();
+void ksyscall_fs_unlink();
+void ksyscall_aio_submit();
+void ksyscall_trace_ctl();
+void ksyscall_trace_read();
+void ksyscall_prof_ctl();
+void ksyscall_prof_read();
+void ksyscall_handle_destroy();
 void ksyscall_sem_init();
 void ksyscall_sem_wait();
 void ksyscall_sem_post();
+void ksyscall_sem_trywait();
+void ksyscall_sem_timedwait();
+void sem_free(int num);
+void ksyscall_mutex_init();
+void ksyscall_mutex_lock();
+void ksyscall_mutex_unlock();
+void ksyscall_set_proc_prio();
+void ksyscall_proc_snapshot();
+void mutex_release_all(int pid);
+void ksyscall_cond_init();
+void ksyscall_cond_wait();
+void ksyscall_cond_signal();
+void ksyscall_cond_broadcast();
+void cond_free(int num);
+void ksyscall_rwlock_init();
+void ksyscall_rwlock_rdlock();
+void ksyscall_rwlock_wrlock();
+void ksyscall_rwlock_unlock();
+void rwlock_free(int num);
+void rwlock_release_all(int pid);
+void ksyscall_event_init();
+void ksyscall_event_set();
+void ksyscall_event_clear();
+void ksyscall_event_wait();
+void event_free(int num);
 void ksyscall_msg_send();
 void ksyscall_msg_recv();
-int mbox_enqueue(msg_t *msg, int mbox_num);
+void ksyscall_msg_select();
+void ksyscall_mbox_create();
+void mbox_free(int num);
+int mbox_lookup(int handle);
+int mbox_post(int num, msg_t *msg, int sender);
+int mbox_reserve(int num);
+void mbox_unreserve(int num);
+void ksyscall_ipc_call();
+void ksyscall_ipc_reply_wait();
+void ipc_abort(int pid);
+void ksyscall_chan_create();
+void ksyscall_chan_subscribe();
+void ksyscall_chan_unsubscribe();
+void ksyscall_chan_publish();
+void ksyscall_chan_recv();
+void chan_free(int num);
+void chan_unsubscribe_all(int pid);
+void ksyscall_futex_wait();
+void ksyscall_futex_wake();
+int mbox_enqueue(msg_t *msg, int mbox_num, int sender);
 int mbox_dequeue(msg_t *msg, int mbox_num);
 
 #endif
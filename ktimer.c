@@ -0,0 +1,173 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Interval Timers
+ *
+ * A timer posts a message to a mailbox each time its period elapses. The
+ * message's sender is MSG_SENDER_TIMER and its data is a timer_msg_t.
+ * While a posted message is still unreceived further expiries are only
+ * counted, and the count is filled in when the message is received, so a
+ * slow consumer sees one message carrying the number of periods missed.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kclock.h"
+#include "khandle.h"
+#include "ksyscall.h"
+#include "ktimer.h"
+#include "queue.h"
+#include "string.h"
+
+// Timer table
+static ktimer_t timers[TIMER_MAX];
+
+// Free timer indexes
+static queue_t timer_q;
+
+// Earliest expiry of any timer, so most ticks need not scan the table
+static unsigned long long timer_next_ns;
+
+/**
+ * Initializes the timer table
+ */
+void ktimer_init() {
+    int i;
+
+    sp_memset(timers, 0, sizeof(timers));
+    sp_memset(&timer_q, 0, sizeof(queue_t));
+
+    for (i = 0; i < TIMER_MAX; i++) {
+        enqueue(&timer_q, i);
+    }
+    timer_next_ns = ~0ULL;
+}
+
+/**
+ * Creates a periodic timer
+ * @param  period_ms - interval between expiries in milliseconds
+ * @param  mbox      - handle of the mailbox to post expiries to
+ * @param  owner     - creating process
+ * @return the timer handle; -1 on error
+ */
+int ktimer_create(int period_ms, int mbox, int owner) {
+    ktimer_t *t;
+    int mbox_num;
+    int num;
+    int handle;
+
+    mbox_num = mbox_lookup(mbox);
+
+    if (period_ms <= 0 || mbox_num < 0
+        || mailboxes[mbox_num].msg_size < (int)sizeof(timer_msg_t)) {
+        return -1;
+    }
+
+    if (dequeue(&timer_q, &num) != 0) {
+        return -1;
+    }
+
+    handle = khandle_alloc(HANDLE_TIMER, num, owner);
+    if (handle < 0) {
+        enqueue(&timer_q, num);
+        return -1;
+    }
+
+    t = &timers[num];
+    t->in_use = 1;
+    t->handle = handle;
+    t->mbox = mbox;
+    t->period_ns = (unsigned long long)period_ms * NSEC_PER_MSEC;
+    t->next_ns = kclock_ns() + t->period_ns;
+    t->pending = 0;
+    t->expirations = 0;
+
+    if (t->next_ns < timer_next_ns) {
+        timer_next_ns = t->next_ns;
+    }
+    return handle;
+}
+
+/**
+ * Releases a timer once its handle is destroyed
+ * A message it already posted stays in the mailbox.
+ * @param  num - timer index
+ */
+void ktimer_free(int num) {
+    timers[num].in_use = 0;
+    enqueue(&timer_q, num);
+}
+
+/**
+ * Posts a message for every timer whose period has elapsed
+ * Called from the timer interrupt.
+ */
+void ktimer_expire() {
+    unsigned long long now = kclock_ns();
+    ktimer_t *t;
+    timer_msg_t *data;
+    msg_t msg;
+    int mbox_num;
+    int i;
+
+    if (now < timer_next_ns) {
+        return;
+    }
+
+    timer_next_ns = ~0ULL;
+
+    for (i = 0; i < TIMER_MAX; i++) {
+        t = &timers[i];
+
+        if (!t->in_use) {
+            continue;
+        }
+
+        if (t->next_ns <= now) {
+            // Count every period that has elapsed, however late we are
+            while (t->next_ns <= now) {
+                t->next_ns += t->period_ns;
+                t->expirations++;
+            }
+
+            // Post unless an earlier message is still waiting to be received
+            mbox_num = mbox_lookup(t->mbox);
+            if (!t->pending && mbox_num >= 0) {
+                sp_memset(&msg, 0, sizeof(msg_t));
+                data = (timer_msg_t *)msg.data;
+                data->timer = t->handle;
+                data->expirations = t->expirations;
+
+                if (mbox_post(mbox_num, &msg, MSG_SENDER_TIMER) == 0) {
+                    t->pending = 1;
+                }
+            }
+        }
+
+        if (t->next_ns < timer_next_ns) {
+            timer_next_ns = t->next_ns;
+        }
+    }
+}
+
+/**
+ * Fills in a timer message as it is received with every expiry since the
+ * last one, and lets the timer post again
+ * @param  msg - the message being received
+ */
+void ktimer_received(msg_t *msg) {
+    timer_msg_t *data = (timer_msg_t *)msg->data;
+    int num;
+
+    num = khandle_lookup(data->timer, HANDLE_TIMER);
+
+    // The timer was destroyed; the message keeps the count it was posted with
+    if (num < 0) {
+        return;
+    }
+
+    data->expirations = timers[num].expirations;
+    timers[num].expirations = 0;
+    timers[num].pending = 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Interval Timers
+ */
+#ifndef KTIMER_H
+#define KTIMER_H
+
+#include "global.h"
+#include "ipc.h"
+
+// Maximum number of interval timers
+#define TIMER_MAX PROC_MAX
+
+// Interval timer
+typedef struct {
+    int in_use;                     // 1 if the timer has been created
+    int handle;                     // handle naming the timer
+    int mbox;                       // mailbox handle expiries are posted to
+    unsigned long long period_ns;   // interval between expiries
+    unsigned long long next_ns;     // kclock time of the next expiry
+    int pending;                    // 1 while a posted message is unreceived
+    int expirations;                // expiries not yet reported
+} ktimer_t;
+
+/**
+ * Function declarations
+ */
+void ktimer_init();
+int ktimer_create(int period_ms, int mbox, int owner);
+void ktimer_free(int num);
+void ktimer_expire();
+void ktimer_received(msg_t *msg);
+
+#endif
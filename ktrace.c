@@ -0,0 +1,111 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Event Tracing
+ *
+ * Events are timestamped with the TSC and stored in a fixed ring that
+ * overwrites its oldest entries. Recording is a mask test, a TSC read and
+ * four stores, so it can stay compiled into the scheduler, IPC and IRQ
+ * paths. trace_read() drains the ring for tools/trace2json.py.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kclock.h"
+#include "ktrace.h"
+#include "kwork.h"
+#include "string.h"
+
+volatile unsigned int ktrace_mask;
+
+static trace_event_t trace_ring[TRACE_EVENTS];
+
+// Events recorded and events read; head - tail never exceeds TRACE_EVENTS
+static unsigned int trace_head;
+static unsigned int trace_tail;
+
+// Events overwritten before they were read
+static unsigned int trace_lost;
+
+/**
+ * Initializes tracing (disabled)
+ */
+void ktrace_init() {
+    ktrace_mask = 0;
+    trace_head = 0;
+    trace_tail = 0;
+    trace_lost = 0;
+}
+
+/**
+ * Records an event; use KTRACE() so disabled categories cost one test
+ * @param  type - trace_event_e
+ * @param  pid  - process concerned
+ * @param  arg  - event specific value
+ */
+void ktrace_record(int type, int pid, int arg) {
+    trace_event_t *e;
+    int flags;
+
+    // Deferred work records with interrupts enabled
+    flags = irq_save();
+
+    e = &trace_ring[trace_head & (TRACE_EVENTS - 1)];
+    trace_head++;
+    if (trace_head - trace_tail > TRACE_EVENTS) {
+        trace_tail++;
+        trace_lost++;
+    }
+
+    e->cycles = kclock_cycles();
+    e->type = type;
+    e->pid = pid;
+    e->arg = arg;
+
+    irq_restore(flags);
+}
+
+/**
+ * Sets the enabled trace categories
+ * @param  mask - categories to enable, or -1 to leave them unchanged
+ * @return the previously enabled categories
+ */
+int ktrace_ctl(int mask) {
+    int prev = ktrace_mask;
+
+    if (mask != -1) {
+        ktrace_mask = mask & TRACE_ALL;
+    }
+
+    return prev;
+}
+
+/**
+ * Moves the oldest events into a buffer, preceded by a TRACE_EV_CLOCK
+ * event giving the TSC frequency (its pid is the number of events lost
+ * since the last read)
+ * @param  buf - destination buffer
+ * @param  max - number of events buf can hold
+ * @return number of events stored, or -1 if max is less than 1
+ */
+int ktrace_read(trace_event_t *buf, int max) {
+    int count;
+
+    if (max < 1) {
+        return -1;
+    }
+
+    buf[0].cycles = kclock_cycles();
+    buf[0].type = TRACE_EV_CLOCK;
+    buf[0].pid = trace_lost > 0x7FFF ? 0x7FFF : trace_lost;
+    buf[0].arg = kclock_khz();
+    trace_lost = 0;
+
+    for (count = 1; count < max && trace_tail != trace_head; count++) {
+        buf[count] = trace_ring[trace_tail & (TRACE_EVENTS - 1)];
+        trace_tail++;
+    }
+
+    return count;
+}
@@ -0,0 +1,63 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Kernel Event Tracing
+ */
+#ifndef KTRACE_H
+#define KTRACE_H
+
+// Events kept in the trace buffer (must be a power of two); the oldest are
+// overwritten once it is full
+#define TRACE_EVENTS 4096
+
+// Event categories, enabled with trace_ctl()
+#define TRACE_SCHED 0x1         // process switches
+#define TRACE_WAKE 0x2          // timer wakeups
+#define TRACE_IPC 0x4           // semaphore and mailbox block/unblock
+#define TRACE_IRQ 0x8           // IRQ handler entry/exit
+#define TRACE_ALL 0xF
+
+// Event types
+typedef enum {
+    TRACE_EV_CLOCK,             // arg: TSC frequency (kHz); starts each read
+    TRACE_EV_SCHED_IN,          // pid starts running
+    TRACE_EV_SCHED_OUT,         // pid stops running; arg: its new state
+    TRACE_EV_WAKE,              // pid woken by the timer
+    TRACE_EV_SEM_BLOCK,         // pid waits on semaphore arg
+    TRACE_EV_SEM_WAKE,          // pid given semaphore arg
+    TRACE_EV_MBOX_BLOCK,        // pid waits on mailbox arg
+    TRACE_EV_MBOX_WAKE,         // pid given a message from mailbox arg
+    TRACE_EV_IRQ_ENTER,         // IRQ arg handler starts; pid was running
+    TRACE_EV_IRQ_EXIT           // IRQ arg handler done
+} trace_event_e;
+
+// Trace record, as returned by trace_read()
+typedef struct trace_event_t {
+    unsigned long long cycles;      // TSC when the event was recorded
+    unsigned short type;            // trace_event_e
+    short pid;                      // Process concerned, -1 if none
+    int arg;                        // Event specific value
+} trace_event_t;
+
+// Enabled categories
+extern volatile unsigned int ktrace_mask;
+
+// Records an event if its category is enabled
+#define KTRACE(category, type, pid, arg) \
+    do { \
+        if (ktrace_mask & (category)) { \
+            ktrace_record((type), (pid), (arg)); \
+        } \
+    } while (0)
+
+/**
+ * Function declarations
+ */
+void ktrace_init();
+void ktrace_record(int type, int pid, int arg);
+int ktrace_ctl(int mask);
+int ktrace_read(trace_event_t *buf, int max);
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Deferred Work
+ *
+ * Interrupt handlers do the least they can with interrupts disabled: they
+ * record what happened, raise a work item and dismiss the interrupt. The
+ * raised work runs at the end of kernel_run(), just before the scheduler,
+ * with interrupts enabled. An interrupt taken while work is running is
+ * handled on the kernel stack by kisr_nested(), which may only raise more
+ * work; it must not touch process state or queues.
+ */
+#include "spede.h"
+#include "kernel.h"
+#include "kclock.h"
+#include "kwork.h"
+#include "string.h"
+
+// Registered work handlers
+static kwork_t works[KWORK_MAX];
+static int work_count;
+
+// One bit per raised handler; set by interrupt handlers
+static volatile unsigned int work_pending;
+
+// Time stamp of the current kernel entry, and the longest time the kernel
+// has run with interrupts disabled before getting to deferred work
+static unsigned long long entry_cycles;
+static unsigned long long irqoff_max_cycles;
+
+/**
+ * Disables interrupts
+ * @return the previous flags register, for irq_restore()
+ */
+int irq_save() {
+    int flags;
+
+    asm volatile("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+    return flags;
+}
+
+/**
+ * Restores the interrupt state saved by irq_save()
+ * @param  flags - value returned by irq_save()
+ */
+void irq_restore(int flags) {
+    asm volatile("pushl %0; popfl" : : "g" (flags) : "memory", "cc");
+}
+
+/**
+ * Initializes deferred work
+ */
+void kwork_init() {
+    sp_memset(works, 0, sizeof(works));
+    work_count = 0;
+    work_pending = 0;
+    irqoff_max_cycles = 0;
+}
+
+/**
+ * Registers a deferred work handler
+ * Handlers run in registration order.
+ * @param  name    - name shown in statistics
+ * @param  handler - function to run
+ * @return work identifier to pass to kwork_raise()
+ */
+int kwork_register(char *name, func_ptr_t handler) {
+    if (work_count >= KWORK_MAX) {
+        panic("Too many deferred work handlers");
+    }
+
+    works[work_count].name = name;
+    works[work_count].handler = handler;
+    return work_count++;
+}
+
+/**
+ * Marks a work handler to run before the next schedule
+ * Safe to call from any interrupt handler.
+ * @param  id - work identifier
+ */
+void kwork_raise(int id) {
+    if (id < 0 || id >= work_count) {
+        panic("Invalid deferred work");
+    }
+
+    work_pending |= (1 << id);
+    works[id].raised++;
+}
+
+/**
+ * Records the time the kernel was entered
+ */
+void kwork_enter() {
+    entry_cycles = kclock_cycles();
+}
+
+/**
+ * Runs all raised work with interrupts enabled, until none is left
+ * Returns with interrupts disabled again.
+ */
+void kwork_run() {
+    unsigned long long start;
+    unsigned long long elapsed;
+    unsigned int pending;
+    int id;
+
+    start = kclock_cycles();
+    elapsed = start - entry_cycles;
+    if (elapsed > irqoff_max_cycles) {
+        irqoff_max_cycles = elapsed;
+    }
+
+    while (work_pending != 0) {
+        pending = work_pending;
+        work_pending = 0;
+
+        asm volatile("sti" : : : "memory");
+
+        for (id = 0; id < work_count; id++) {
+            if ((pending & (1 << id)) == 0) {
+                continue;
+            }
+
+            start = kclock_cycles();
+            works[id].handler();
+            elapsed = kclock_cycles() - start;
+
+            works[id].runs++;
+            works[id].cycles += elapsed;
+            if (elapsed > works[id].max_cycles) {
+                works[id].max_cycles = elapsed;
+            }
+        }
+
+        asm volatile("cli" : : : "memory");
+    }
+}
+
+/**
+ * Prints deferred work statistics to the console
+ */
+void kwork_dump() {
+    int i;
+    unsigned long long avg;
+    unsigned long long irqoff_us;
+
+    irqoff_us = kclock_cycles_to_ns(irqoff_max_cycles);
+    kclock_div(&irqoff_us, 1000);
+    cons_printf("irq-off max=%dus\n", (int)irqoff_us);
+
+    for (i = 0; i < work_count; i++) {
+        avg = works[i].cycles;
+        if (works[i].runs > 0) {
+            kclock_div(&avg, works[i].runs);
+        }
+        cons_printf("work %s raised=%d runs=%d avg=%dns max=%dns\n",
+                    works[i].name, works[i].raised, works[i].runs,
+                    (int)kclock_cycles_to_ns(avg),
+                    (int)kclock_cycles_to_ns(works[i].max_cycles));
+    }
+}
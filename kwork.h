@@ -0,0 +1,38 @@
+/**
+ * CPE/CSC 159 - Operating System Pragmatics
+ * California State University, Sacramento
+ * Fall 2020
+ *
+ * Deferred Work
+ */
+#ifndef KWORK_H
+#define KWORK_H
+
+#include "global.h"
+
+// Maximum number of deferred work handlers (one pending bit each)
+#define KWORK_MAX 32
+
+// Deferred work handler
+typedef struct {
+    char *name;                     // name shown in statistics
+    func_ptr_t handler;             // function run with interrupts enabled
+    int raised;                     // times the work was raised
+    int runs;                       // times the handler ran
+    unsigned long long cycles;      // total handler run time
+    unsigned long long max_cycles;  // longest single run
+} kwork_t;
+
+/**
+ * Function declarations
+ */
+void kwork_init();
+int kwork_register(char *name, func_ptr_t handler);
+void kwork_raise(int id);
+void kwork_enter();
+void kwork_run();
+void kwork_dump();
+int irq_save();
+void irq_restore(int flags);
+
+#endif
@@ -11,6 +11,21 @@
 #include "kernel.h"
 #include "kisr.h"
 #include "kproc.h"
+#include "kmem.h"
+#include "khandle.h"
+#include "kclock.h"
+#include "ktimer.h"
+#include "kwork.h"
+#include "kirq.h"
+#include "kkbd.h"
+#include "kcons.h"
+#include "kserial.h"
+#include "kata.h"
+#include "kbcache.h"
+#include "kfs.h"
+#include "kaio.h"
+#include "ktrace.h"
+#include "kprof.h"
 #include "queue.h"
 #include "string.h"
 #include "user_proc.h"
@@ -31,10 +46,15 @@ int run_pid;
 
 // Process queues
 queue_t available_q;
-queue_t run_q;
+queue_t run_q[PROC_PRIO_MAX];
 queue_t idle_q;
 queue_t sleep_q;
 queue_t semaphore_q;
+queue_t condition_q;
+queue_t rwlock_q;
+queue_t event_q;
+queue_t mailbox_q;
+queue_t channel_q;
 
 // Process table
 pcb_t pcb[PROC_MAX];
@@ -42,9 +62,24 @@ pcb_t pcb[PROC_MAX];
 //Semaphore Array
 semaphore_t semaphores[SEMAPHORE_MAX];
 
+//Condition variable table
+condition_t conditions[COND_MAX];
+
+//Reader-writer lock table
+readwrite_lock_t rwlocks[RWLOCK_MAX];
+
+//Event flag table
+event_group_t events[EVENT_MAX];
+
 //Mailbox table
 mailbox_t mailboxes[MBOX_MAX];
 
+//Futex table
+futex_t futexes[FUTEX_MAX];
+
+//Broadcast channel table
+channel_t channels[CHAN_MAX];
+
 // runtime stacks of processes
 char stack[PROC_MAX][PROC_STACK_SIZE];
 
@@ -60,13 +95,29 @@ int main() {
     // Initialize kernel data structures
     kdata_init();
 
+    // Register the deferred work of the interrupt handlers
+    kisr_init();
+
+    // Take keyboard input through IRQ 1
+    kkbd_init();
+
+    // Bring up the serial port on COM1
+    kserial_init();
+
+    // Identify the disk on the primary ATA channel
+    kata_init();
+
+    // Calibrate the high resolution clock before interrupts are enabled
+    kclock_init();
+
     // Initialize the IDT
     idt_init();
 
     // Launch the kernel idle task
     kproc_exec("ktask_idle", &ktask_idle, &idle_q);
-    kproc_exec("dispatcher_proc", &dispatcher_proc, &run_q);
-    kproc_exec("printer_proc", &printer_proc, &run_q);
+    kproc_exec("ktask_cons", &ktask_cons, &run_q[PROC_PRIO_DEFAULT]);
+    kproc_exec("dispatcher_proc", &dispatcher_proc, &run_q[PROC_PRIO_DEFAULT]);
+    kproc_exec("printer_proc", &printer_proc, &run_q[PROC_PRIO_DEFAULT]);
 
     // Start the process scheduler
     kproc_schedule();
@@ -86,13 +137,23 @@ void kdata_init() {
     int i;
     // Initialize all of our kernel queues
 	sp_memset((char *)&available_q, 0, sizeof(queue_t));
-	sp_memset((char *)&run_q, 0, sizeof(queue_t));
+	sp_memset((char *)&run_q, 0, sizeof(run_q));
 	sp_memset((char *)&idle_q, 0, sizeof(queue_t));
 	sp_memset((char *)&sleep_q, 0, sizeof(queue_t));
     sp_memset((char *)&pcb, 0, sizeof(pcb));
     sp_memset((char *)&stack, 0, sizeof(stack));
     sp_memset((char *)&semaphore_q, 0, sizeof(queue_t));
-    sp_memset((char *)&mailboxes, 0, sizeof(mailbox_t));
+    sp_memset((char *)&condition_q, 0, sizeof(queue_t));
+    sp_memset((char *)&conditions, 0, sizeof(conditions));
+    sp_memset((char *)&rwlock_q, 0, sizeof(queue_t));
+    sp_memset((char *)&rwlocks, 0, sizeof(rwlocks));
+    sp_memset((char *)&event_q, 0, sizeof(queue_t));
+    sp_memset((char *)&events, 0, sizeof(events));
+    sp_memset((char *)&mailbox_q, 0, sizeof(queue_t));
+    sp_memset((char *)&mailboxes, 0, sizeof(mailboxes));
+    sp_memset((char *)&futexes, 0, sizeof(futexes));
+    sp_memset((char *)&channel_q, 0, sizeof(queue_t));
+    sp_memset((char *)&channels, 0, sizeof(channels));
     sp_memset((char *)&semaphores, 0, sizeof(semaphore_t));
 
     // Ensure that all processes are initially in our available queue
@@ -106,6 +167,44 @@ void kdata_init() {
     for(i = 0; i < SEMAPHORE_MAX; i++) {
         enqueue(&semaphore_q, i);
     }
+
+    //Initialize condition variable queue with condition indexes
+    for(i = 0; i < COND_MAX; i++) {
+        enqueue(&condition_q, i);
+    }
+
+    //Initialize reader-writer lock queue with lock indexes
+    for(i = 0; i < RWLOCK_MAX; i++) {
+        enqueue(&rwlock_q, i);
+    }
+
+    //Initialize event queue with event indexes
+    for(i = 0; i < EVENT_MAX; i++) {
+        enqueue(&event_q, i);
+    }
+
+    //Initialize mailbox queue with mailbox indexes
+    for(i = 0; i < MBOX_MAX; i++) {
+        enqueue(&mailbox_q, i);
+    }
+
+    //Initialize channel queue with channel indexes
+    for(i = 0; i < CHAN_MAX; i++) {
+        enqueue(&channel_q, i);
+    }
+
+    // Initialize the kernel memory pool
+    kmem_init();
+    khandle_init();
+    ktimer_init();
+    kwork_init();
+    kirq_init();
+    kcons_init();
+    kbcache_init();
+    kfs_init();
+    kaio_init();
+    ktrace_init();
+    kprof_init();
     // Initialize system time
     // Initiallize the running pid
     system_time = 0;
@@ -114,17 +213,20 @@ void kdata_init() {
 
 /**
  * Interrupt Descriptor Table initialization
- * This adds entries to the IDT and then enables interrupts
+ * This adds entries to the IDT; IRQ lines are enabled as drivers register
  */
 void idt_init() {
+    int irq;
+
     // Get the IDT base address
     idt_p = get_idt_base();
 
-    // Add an entry for each interrupt into the IDT
-    idt_entry_add(TIMER_INTR, kisr_entry_timer);
+    // Add an entry for each interrupt into the IDT; IRQ lines stay masked
+    // at the PIC until a driver registers a handler
+    for (irq = 0; irq < IRQ_MAX; irq++) {
+        idt_entry_add(IRQ_BASE + irq, kisr_entry_irq[irq]);
+    }
     idt_entry_add(SYSCALL_INTR, kisr_entry_syscall);
-    // Clear the PIC mask to enable interrupts
-    outportb(0x21, ~1);
 }
 
 
@@ -158,72 +260,132 @@ void idt_entry_add(int entry_num, func_ptr_t func_ptr) {
  * @param  trapframe - pointer to the current trapframe
  */
 void kernel_run(trapframe_t *trapframe) {
-    char key;
     if (run_pid < 0 || run_pid > PID_MAX) {
         panic("Invalid PID!");
     }
 
+    // Note the time interrupts were disabled
+    kwork_enter();
+
     // save the trapframe into the PCB of the currently running process
     pcb[run_pid].trapframe_p = trapframe;
 
     // Process the current interrupt and call the appropriate service routine
     switch (trapframe->interrupt) {
-        // Timer interrupt
-        case TIMER_INTR:
-            kisr_timer();
-            break;
-
         case SYSCALL_INTR:
             kisr_syscall();
             break;
 
         default:
-            panic("Invalid interrupt");
+            // Hardware interrupts
+            if (trapframe->interrupt < IRQ_BASE || trapframe->interrupt >= IRQ_BASE + IRQ_MAX) {
+                panic("Invalid interrupt");
+            }
+            kirq_dispatch(trapframe->interrupt - IRQ_BASE, trapframe);
             break;
     }
 
-    // Process special developer/debug commands
-    if (cons_kbhit()) {
-        key = cons_getchar();
+    // Run deferred work with interrupts enabled
+    kwork_run();
+
+    // Run the process scheduler
+    kproc_schedule();
+
+    // Load the next process
+    kproc_load(pcb[run_pid].trapframe_p);
+}
+
+/**
+ * Runs a special developer/debug command
+ * Called by the keyboard driver for every key, before any process reads it
+ *
+ * @param  key - the key pressed
+ * @return 0 if the key was a command, -1 otherwise
+ */
+int kernel_command(char key) {
+    switch (key) {
+        case 'b':
+            // Set a breakpoint
+            breakpoint();
+            break;
+
+        case 'n':
+            // Create a new process
+            kproc_exec("user_proc", &user_proc, &run_q[PROC_PRIO_DEFAULT]);
+            break;
+
+        case 'w':
+            // Show deferred work statistics
+            kwork_dump();
+            break;
+
+        case 'i':
+            // Show IRQ statistics
+            kirq_dump();
+            break;
+
+        case 't':
+            // Start or stop tracing
+            ktrace_mask = ktrace_mask ? 0 : TRACE_ALL;
+            cons_printf("Tracing %s\n", ktrace_mask ? "on" : "off");
+            break;
+
+        case 'd':
+            // Dump the trace to COM1
+            kproc_exec("trace_proc", &trace_proc, &run_q[PROC_PRIO_DEFAULT]);
+            break;
+
+        case 'r':
+            // Start or stop the sampling profiler
+            kprof_enabled = !kprof_enabled;
+            cons_printf("Profiling %s\n", kprof_enabled ? "on" : "off");
+            break;
+
+        case 'f':
+            // Dump the profiler samples to COM1
+            kproc_exec("prof_proc", &prof_proc, &run_q[PROC_PRIO_DEFAULT]);
+            break;
 
-        switch (key) {
-            case 'b':
-                // Set a breakpoint
-                breakpoint();
-                break;
+        case 'o':
+            // Log the process table a few times
+            kproc_exec("top_proc", &top_proc, &run_q[PROC_PRIO_DEFAULT]);
+            break;
 
-            case 'n':
-                // Create a new process
-                kproc_exec("user_proc", &user_proc, &run_q);
-                break;
+        case 'c':
+            // Check synchronous IPC; the server starts first so it is
+            // already waiting when the client calls
+            kproc_exec("ipc_check_server", &ipc_check_server, &run_q[PROC_PRIO_DEFAULT]);
+            kproc_exec("ipc_check_client", &ipc_check_client, &run_q[PROC_PRIO_DEFAULT]);
+            break;
 
-            case 'p':
-                // Trigger a panic (aborts)
-                panic("User requested panic!");
-                break;
+        case 'k':
+            // Check the block cache while the drive fails some writes
+            kata_fail_writes(BLK_CHECK_FAILS);
+            kproc_exec("blk_check", &blk_check, &run_q[PROC_PRIO_DEFAULT]);
+            break;
 
-            case 'x':
-                // Exit the currently running process
+        case 'p':
+            // Trigger a panic (aborts)
+            panic("User requested panic!");
+            break;
+
+        case 'x':
+            // Exit the currently running process
+            if (run_pid >= 0) {
                 kproc_exit();
-                break;
-
-            case 'q':
-                // Exit our kernel
-                cons_printf("Exiting!!!\n");
-                debug_printf("Exiting!!!\n");
-                exit(0);
-                break;
-
-            default:
-                // Display a warning (no abort)
-                panic_warn("Unknown command entered");
-                break;
-        }
-    }
+            }
+            break;
 
-    // Run the process scheduler
-    kproc_schedule();
+        case 'q':
+            // Exit our kernel
+            cons_printf("Exiting!!!\n");
+            debug_printf("Exiting!!!\n");
+            exit(0);
+            break;
 
-    // Load the next process
-    kproc_load(pcb[run_pid].trapframe_p);
+        default:
+            return -1;
+    }
+
+    return 0;
 }
@@ -37,6 +37,29 @@ int enqueue(queue_t *queue, int item) {
     return 0;
 }
 
+/**
+ * Adds several items to the end of a queue in one operation
+ * @param  queue - pointer to the queue
+ * @param  items - the items to add, in order
+ * @param  count - number of items
+ * @return -1 if they do not all fit (nothing is added); 0 on success
+ */
+int enqueue_batch(queue_t *queue, int *items, int count) {
+    int i;
+
+    if (count < 0 || queue->size + count > QUEUE_SIZE) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        queue->items[queue->tail] = items[i];
+        queue->tail = (queue->tail + 1) % QUEUE_SIZE;
+    }
+    queue->size = queue->size + count;
+
+    return 0;
+}
+
 /**
  * Pulls an item from the specified queue
  * @param  queue - pointer to the queue
@@ -64,3 +87,43 @@ int dequeue(queue_t *queue, int *item) {
 	queue->size = queue->size - 1;
     return 0;
 }
+
+/**
+ * Removes the first occurrence of an item from anywhere in a queue,
+ * preserving the order of the remaining items
+ * @param  queue - pointer to the queue
+ * @param  item  - the item to remove
+ * @return -1 if the item was not found; 0 on success
+ */
+int queue_remove(queue_t *queue, int item) {
+    int i;
+    int pos;
+    int next;
+    int found = 0;
+
+    // Walk the queue from head to tail looking for the item
+    pos = queue->head;
+    for (i = 0; i < queue->size; i++) {
+        if (queue->items[pos] == item) {
+            found = 1;
+            break;
+        }
+        pos = (pos + 1) % QUEUE_SIZE;
+    }
+
+    if (!found) {
+        return -1;
+    }
+
+    // Shift every item after the removed one forward by one slot
+    for (i = i + 1; i < queue->size; i++) {
+        next = (pos + 1) % QUEUE_SIZE;
+        queue->items[pos] = queue->items[next];
+        pos = next;
+    }
+
+    // The tail moves back one slot (wrapping to the end of the array)
+    queue->tail = pos;
+    queue->size = queue->size - 1;
+    return 0;
+}
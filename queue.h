@@ -25,4 +25,6 @@ typedef struct {
  */
 int enqueue(queue_t *queue, int item);
 int dequeue(queue_t *queue, int *item);
+int queue_remove(queue_t *queue, int item);
+int enqueue_batch(queue_t *queue, int *items, int count);
 #endif
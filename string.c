@@ -172,3 +172,188 @@ int sp_strncmp(const char *str1, const char *str2, size_t n) {
     }
     return 0;
 }
+
+/**
+ * Appends a character to a bounded output buffer
+ * Characters past the end of the buffer are counted but not stored.
+ *
+ * @param  buf  - destination buffer
+ * @param  size - size of the destination buffer
+ * @param  len  - number of characters formatted so far
+ * @param  c    - character to append
+ */
+static void sp_putc(char *buf, size_t size, int *len, char c) {
+    if ((size_t)*len + 1 < size) {
+        buf[*len] = c;
+    }
+    (*len)++;
+}
+
+/**
+ * Formats a string into a buffer of limited size
+ * Supports %d, %i, %u, %x, %X, %c, %s, %p and %% with the '-' and '0'
+ * flags, a field width and a precision. The output is cut off at size - 1
+ * characters and always terminated when size is not 0.
+ *
+ * @param  buf    - destination buffer
+ * @param  size   - size of the destination buffer
+ * @param  format - format string
+ * @param  args   - arguments for the format string
+ * @return length of the whole formatted string, which is size or more if
+ *         it was cut off
+ */
+int sp_vsnprintf(char *buf, size_t size, const char *format, __builtin_va_list args) {
+    char digits[12];
+    const char *hex;
+    const char *str;
+    unsigned int value;
+    int len = 0;
+    int left;
+    int zero;
+    int width;
+    int prec;
+    int neg;
+    int n;
+    int i;
+
+    for (; *format; format++) {
+        if (*format != '%') {
+            sp_putc(buf, size, &len, *format);
+            continue;
+        }
+
+        left = 0;
+        zero = 0;
+        for (format++; *format == '-' || *format == '0'; format++) {
+            if (*format == '-') {
+                left = 1;
+            } else {
+                zero = 1;
+            }
+        }
+
+        width = 0;
+        for (; *format >= '0' && *format <= '9'; format++) {
+            width = width * 10 + *format - '0';
+        }
+
+        prec = -1;
+        if (*format == '.') {
+            prec = 0;
+            for (format++; *format >= '0' && *format <= '9'; format++) {
+                prec = prec * 10 + *format - '0';
+            }
+        }
+
+        neg = 0;
+        n = 0;
+        str = digits;
+        hex = "0123456789abcdef";
+
+        switch (*format) {
+            case 'd':
+            case 'i':
+                value = __builtin_va_arg(args, int);
+                if ((int)value < 0) {
+                    neg = 1;
+                    value = -value;
+                }
+                do {
+                    digits[n++] = '0' + value % 10;
+                    value /= 10;
+                } while (value);
+                break;
+
+            case 'u':
+                value = __builtin_va_arg(args, unsigned int);
+                do {
+                    digits[n++] = '0' + value % 10;
+                    value /= 10;
+                } while (value);
+                break;
+
+            case 'X':
+                hex = "0123456789ABCDEF";
+                // fall through
+            case 'x':
+            case 'p':
+                value = *format == 'p' ? (unsigned int)__builtin_va_arg(args, void *)
+                                       : __builtin_va_arg(args, unsigned int);
+                do {
+                    digits[n++] = hex[value & 0xf];
+                    value >>= 4;
+                } while (value);
+                break;
+
+            case 'c':
+                digits[0] = (char)__builtin_va_arg(args, int);
+                n = 1;
+                break;
+
+            case 's':
+                str = __builtin_va_arg(args, const char *);
+                if (str == 0) {
+                    str = "(null)";
+                }
+                for (n = 0; str[n] && (prec < 0 || n < prec); n++);
+                break;
+
+            case '%':
+                sp_putc(buf, size, &len, '%');
+                continue;
+
+            default:
+                // Unknown conversion: copy it as it is
+                if (*format == '\0') {
+                    format--;
+                } else {
+                    sp_putc(buf, size, &len, *format);
+                }
+                continue;
+        }
+
+        // Numbers are built backwards in digits[]; strings and characters
+        // are copied as they are
+        if (*format == 's' || *format == 'c') {
+            for (i = n; !left && i < width; i++) {
+                sp_putc(buf, size, &len, ' ');
+            }
+            for (i = 0; i < n; i++) {
+                sp_putc(buf, size, &len, str[i]);
+            }
+            for (i = n; left && i < width; i++) {
+                sp_putc(buf, size, &len, ' ');
+            }
+            continue;
+        }
+
+        if (prec < n) {
+            prec = n;
+        }
+        if (zero && !left && width - neg > prec) {
+            prec = width - neg;
+        }
+
+        for (i = prec + neg; !left && i < width; i++) {
+            sp_putc(buf, size, &len, ' ');
+        }
+        if (neg) {
+            sp_putc(buf, size, &len, '-');
+        }
+        for (i = n; i < prec; i++) {
+            sp_putc(buf, size, &len, '0');
+        }
+        while (n > 0) {
+            sp_putc(buf, size, &len, digits[--n]);
+        }
+        for (i = prec + neg; left && i < width; i++) {
+            sp_putc(buf, size, &len, ' ');
+        }
+    }
+
+    if (size > 0) {
+        buf[(size_t)len < size ? (size_t)len : size - 1] = '\0';
+    }
+
+    return len;
+}
@@ -103,4 +103,19 @@ int sp_strcmp(const char *str1, const char *str2);
  */
 int sp_strncmp(const char *str1, const char *str2, size_t n);
 
+/**
+ * Formats a string into a buffer of limited size
+ * Supports %d, %i, %u, %x, %X, %c, %s, %p and %% with the '-' and '0'
+ * flags, a field width and a precision. The output is cut off at size - 1
+ * characters and always terminated when size is not 0.
+ *
+ * @param  buf    - destination buffer
+ * @param  size   - size of the destination buffer
+ * @param  format - format string
+ * @param  args   - arguments for the format string
+ * @return length of the whole formatted string, which is size or more if
+ *         it was cut off
+ */
+int sp_vsnprintf(char *buf, size_t size, const char *format, __builtin_va_list args);
+
 #endif
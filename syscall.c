@@ -5,8 +5,15 @@
  *
  * System call APIs
  */
+#include "spede.h"
 #include "syscall.h"
 #include "kernel.h"
+#include "khandle.h"
+#include "string.h"
+
+int atomic_cmpxchg(volatile int *ptr, int old_val, int new_val);
+void atomic_add(volatile int *ptr, int delta);
+int handle_release(int *handle, int type);
 /*
  * Anatomy of a system call
  *
@@ -152,66 +159,1223 @@ void sleep(int seconds) {
         : "eax", "ebx");
 }
 
-void sem_init(sem_t *sem) {
-    //trigger the system call
-    //pointer to semaphore index is sent to the kernel
-    //no data is returned from the kernel
+/**
+ * Returns the time since boot with nanosecond resolution
+ *
+ * @param   ts - destination for the seconds and nanoseconds
+ * @return  none
+ */
+void clock_gettime(timespec_t *ts) {
+    // trigger the system call
+    // destination pointer is sent to the kernel
+    // no data is returned from the kernel
     asm("movl %0, %%eax;"
         "movl %1, %%ebx;"
         "int $0x80;"
         :
-        : "g" (SYSCALL_SEM_INIT), "g" (sem)
+        : "g" (SYSCALL_CLOCK_GETTIME), "g" (ts)
+        : "eax", "ebx");
+}
+
+/**
+ * Puts the currently running (calling) process to sleep for at least
+ * the requested interval
+ *
+ * @param   req - interval to sleep
+ * @return  0 on success, -1 if the interval is invalid
+ */
+int nanosleep(const timespec_t *req) {
+    // trigger the system call
+    // pointer to the interval is sent to the kernel
+    // status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_NANOSLEEP), "g" (req)
         : "eax", "ebx");
+
+    return rc;
+}
+
+/**
+ * Puts the currently running (calling) process to sleep for at least
+ * the given number of milliseconds
+ *
+ * @param   ms - number of milliseconds to sleep
+ * @return  0 on success, -1 if ms is negative
+ */
+int msleep(int ms) {
+    timespec_t req;
+
+    req.tv_sec = ms / 1000;
+    req.tv_nsec = (ms % 1000) * 1000000;
+
+    return nanosleep(&req);
 }
 
-void sem_wait(sem_t *sem) {
+int timer_create(int period_ms, int mbox) {
     //trigger the system call
-    //pointer to semaphore index is sent to the kernel
-    //no data is returned from the kernel
-    asm("movl %0, %%eax;"
-        "movl %1, %%ebx;"
+    //period and mailbox handle are sent to the kernel
+    //timer handle is returned from the kernel
+    int timer;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
         "int $0x80;"
-        :
-        : "g" (SYSCALL_SEM_WAIT), "g" (sem)
+        "movl %%ebx, %0;"
+        : "=g" (timer)
+        : "g" (SYSCALL_TIMER_CREATE), "g" (period_ms), "g" (mbox)
+        : "eax", "ebx", "ecx");
+
+    return timer;
+}
+
+int timer_destroy(int timer) {
+    return handle_destroy(timer, HANDLE_TIMER);
+}
+
+int set_tick_hz(int hz) {
+    //trigger the system call
+    //frequency is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SET_TICK_HZ), "g" (hz)
         : "eax", "ebx");
+
+    return rc;
 }
 
-void sem_post(sem_t *sem) {
+int set_timer_slack(int slack_us) {
     //trigger the system call
-    //pointer to semaphore index is sent to the kernel
-    //no data is returned from the kernel
-    asm("movl %0, %%eax;"
-        "movl %1, %%ebx;"
+    //slack is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
         "int $0x80;"
-        :
-        : "g" (SYSCALL_SEM_POST), "g" (sem)
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SET_TIMER_SLACK), "g" (slack_us)
         : "eax", "ebx");
+
+    return rc;
 }
 
-void msg_send(msg_t *msg, int mbox_num) {
+int irq_stats(int irq, irq_stats_t *stats) {
     //trigger the system call
-    //pointer to msg is sent to the kernel
-    //mail box number is sent to the kernel
-    //no data is returned from the kernel
-    asm("movl %0, %%eax;"
-        "movl %1, %%ebx;"
-        "movl %2, %%ecx;"
+    //IRQ line and destination pointer are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
         "int $0x80;"
-        :
-        : "g" (SYSCALL_MSG_SEND), "g" (msg), "g" (mbox_num)
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_IRQ_STATS), "g" (irq), "g" (stats)
         : "eax", "ebx", "ecx");
+
+    return rc;
 }
 
-void msg_recv(msg_t *msg, int mbox_num) {
+int read_key(void) {
     //trigger the system call
-    //pointer to msg is sent to the kernel
-    //mail box number is sent to the kernel
-    //no data is returned from the kernel
-    asm("movl %0, %%eax;"
-        "movl %1, %%ebx;"
-        "movl %2, %%ecx;"
+    //no data sent to the kernel
+    //the key is returned from the kernel
+    int key;
+
+    asm("movl %1, %%eax;"
         "int $0x80;"
-        :
-        : "g" (SYSCALL_MSG_RECV), "g" (msg), "g" (mbox_num)
+        "movl %%ebx, %0;"
+        : "=g" (key)
+        : "g" (SYSCALL_READ_KEY)
+        : "eax", "ebx");
+
+    return key;
+}
+
+int cons_write(const char *record, int len) {
+    //trigger the system call
+    //record and length are sent to the kernel
+    //number of bytes buffered is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_CONS_WRITE), "g" (record), "g" (len)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int cons_log(const char *format, ...) {
+    char record[CONS_RECORD_MAX];
+    va_list args;
+    int len;
+
+    // Format with a bound so a long record cannot overrun the stack
+    va_start(args, format);
+    len = sp_vsnprintf(record, sizeof(record), format, args);
+    va_end(args);
+
+    if (len >= CONS_RECORD_MAX) {
+        return -1;
+    }
+
+    return cons_write(record, len);
+}
+
+int serial_read(char *buf, int len, int flags) {
+    //trigger the system call
+    //buffer, length and flags are sent to the kernel
+    //number of bytes read is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "movl %4, %%edx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SERIAL_READ), "g" (buf), "g" (len), "g" (flags)
+        : "eax", "ebx", "ecx", "edx");
+
+    return rc;
+}
+
+int serial_write(const char *buf, int len, int flags) {
+    //trigger the system call
+    //buffer, length and flags are sent to the kernel
+    //number of bytes queued is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "movl %4, %%edx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SERIAL_WRITE), "g" (buf), "g" (len), "g" (flags)
+        : "eax", "ebx", "ecx", "edx");
+
+    return rc;
+}
+
+int blk_read(int block, void *buf) {
+    //trigger the system call
+    //block number and destination buffer are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_BLK_READ), "g" (block), "g" (buf)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int blk_write(int block, const void *buf) {
+    //trigger the system call
+    //block number and source buffer are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_BLK_WRITE), "g" (block), "g" (buf)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int blk_sync(void) {
+    //trigger the system call
+    //no data sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_BLK_SYNC)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int fs_open(const char *name, int flags) {
+    //trigger the system call
+    //file name and flags are sent to the kernel
+    //file handle is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_FS_OPEN), "g" (name), "g" (flags)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int fs_read(int fd, void *buf, int len) {
+    //trigger the system call
+    //file handle, buffer and length are sent to the kernel
+    //number of bytes read is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "movl %4, %%edx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_FS_READ), "g" (fd), "g" (buf), "g" (len)
+        : "eax", "ebx", "ecx", "edx");
+
+    return rc;
+}
+
+int fs_write(int fd, const void *buf, int len) {
+    //trigger the system call
+    //file handle, buffer and length are sent to the kernel
+    //number of bytes written is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "movl %4, %%edx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_FS_WRITE), "g" (fd), "g" (buf), "g" (len)
+        : "eax", "ebx", "ecx", "edx");
+
+    return rc;
+}
+
+int fs_close(int fd) {
+    return handle_destroy(fd, HANDLE_FILE);
+}
+
+void *fs_mmap(int fd, int offset, int len) {
+    //trigger the system call
+    //file handle, offset and length are sent to the kernel
+    //address of the mapping is returned from the kernel
+    void *addr;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "movl %4, %%edx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (addr)
+        : "g" (SYSCALL_FS_MMAP), "g" (fd), "g" (offset), "g" (len)
+        : "eax", "ebx", "ecx", "edx");
+
+    return addr;
+}
+
+int fs_unlink(const char *name) {
+    //trigger the system call
+    //file name is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_FS_UNLINK), "g" (name)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int aio_submit(aio_req_t *req) {
+    //trigger the system call
+    //request is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_AIO_SUBMIT), "g" (req)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int trace_ctl(int mask) {
+    //trigger the system call
+    //category mask is sent to the kernel
+    //previous mask is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_TRACE_CTL), "g" (mask)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int trace_read(trace_event_t *events, int count) {
+    //trigger the system call
+    //buffer and its size are sent to the kernel
+    //number of events copied is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_TRACE_READ), "g" (events), "g" (count)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int prof_ctl(int enable) {
+    //trigger the system call
+    //enable flag is sent to the kernel
+    //previous state is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_PROF_CTL), "g" (enable)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int prof_read(prof_sample_t *samples, int count) {
+    //trigger the system call
+    //buffer and its size are sent to the kernel
+    //number of samples copied is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_PROF_READ), "g" (samples), "g" (count)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int cons_wait(void) {
+    //trigger the system call
+    //no data sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_CONS_WAIT)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int sem_init(sem_t *sem, int value) {
+    //trigger the system call
+    //pointer to semaphore index and initial count are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SEM_INIT), "g" (sem), "g" (value)
         : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int sem_wait(sem_t *sem) {
+    //trigger the system call
+    //pointer to semaphore index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SEM_WAIT), "g" (sem)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int sem_trywait(sem_t *sem) {
+    //trigger the system call
+    //pointer to semaphore index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SEM_TRYWAIT), "g" (sem)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int sem_timedwait(sem_t *sem, int timeout_ms) {
+    //trigger the system call
+    //pointer to semaphore index and timeout are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SEM_TIMEDWAIT), "g" (sem), "g" (timeout_ms)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int sem_post(sem_t *sem) {
+    //trigger the system call
+    //pointer to semaphore index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SEM_POST), "g" (sem)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int mutex_init(sem_t *mutex) {
+    //trigger the system call
+    //pointer to mutex index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_MUTEX_INIT), "g" (mutex)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int mutex_lock(sem_t *mutex) {
+    //trigger the system call
+    //pointer to mutex index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_MUTEX_LOCK), "g" (mutex)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int mutex_unlock(sem_t *mutex) {
+    //trigger the system call
+    //pointer to mutex index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_MUTEX_UNLOCK), "g" (mutex)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int cond_init(cond_t *cond) {
+    //trigger the system call
+    //pointer to condition index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_COND_INIT), "g" (cond)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int cond_wait(cond_t *cond, sem_t *mutex) {
+    //trigger the system call
+    //pointers to condition and mutex indexes are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_COND_WAIT), "g" (cond), "g" (mutex)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int cond_signal(cond_t *cond) {
+    //trigger the system call
+    //pointer to condition index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_COND_SIGNAL), "g" (cond)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int cond_broadcast(cond_t *cond) {
+    //trigger the system call
+    //pointer to condition index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_COND_BROADCAST), "g" (cond)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int rwlock_init(rwlock_t *rwlock) {
+    //trigger the system call
+    //pointer to reader-writer lock index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_RWLOCK_INIT), "g" (rwlock)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int rwlock_rdlock(rwlock_t *rwlock) {
+    //trigger the system call
+    //pointer to reader-writer lock index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_RWLOCK_RDLOCK), "g" (rwlock)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int rwlock_wrlock(rwlock_t *rwlock) {
+    //trigger the system call
+    //pointer to reader-writer lock index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_RWLOCK_WRLOCK), "g" (rwlock)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int rwlock_unlock(rwlock_t *rwlock) {
+    //trigger the system call
+    //pointer to reader-writer lock index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_RWLOCK_UNLOCK), "g" (rwlock)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int event_init(event_t *event) {
+    //trigger the system call
+    //pointer to event flag group index is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_EVENT_INIT), "g" (event)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int event_set(event_t *event, unsigned int mask) {
+    //trigger the system call
+    //pointer to event index and flags are sent to the kernel
+    //number of processes woken is returned from the kernel
+    int woken;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (woken)
+        : "g" (SYSCALL_EVENT_SET), "g" (event), "g" (mask)
+        : "eax", "ebx", "ecx");
+
+    return woken;
+}
+
+int event_clear(event_t *event, unsigned int mask) {
+    //trigger the system call
+    //pointer to event index and flags are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_EVENT_CLEAR), "g" (event), "g" (mask)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int event_wait(event_t *event, unsigned int mask, int mode, unsigned int *flags) {
+    //trigger the system call
+    //pointer to event index, flags and wait mode are sent to the kernel
+    //status is returned from the kernel in ebx, the flag word in ecx
+    int rc;
+    unsigned int word;
+
+    asm("movl %2, %%eax;"
+        "movl %3, %%ebx;"
+        "movl %4, %%ecx;"
+        "movl %5, %%edx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        "movl %%ecx, %1;"
+        : "=g" (rc), "=g" (word)
+        : "g" (SYSCALL_EVENT_WAIT), "g" (event), "g" (mask), "g" (mode)
+        : "eax", "ebx", "ecx", "edx");
+
+    if (rc == 0 && flags != NULL) {
+        *flags = word;
+    }
+    return rc;
+}
+
+int set_proc_prio(int prio) {
+    //trigger the system call
+    //new priority is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_SET_PROC_PRIO), "g" (prio)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int proc_snapshot(proc_stat_t *buf, int max) {
+    //trigger the system call
+    //buffer and its size are sent to the kernel
+    //number of processes copied is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_PROC_SNAPSHOT), "g" (buf), "g" (max)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int msg_send(msg_t *msg, int mbox_num) {
+    //trigger the system call
+    //pointer to msg is sent to the kernel
+    //mail box handle is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_MSG_SEND), "g" (msg), "g" (mbox_num)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int msg_recv(msg_t *msg, int mbox_num) {
+    //trigger the system call
+    //pointer to msg is sent to the kernel
+    //mail box handle is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_MSG_RECV), "g" (msg), "g" (mbox_num)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int msg_select(msg_select_t *sel) {
+    //trigger the system call
+    //pointer to the select set is sent to the kernel
+    //number of ready entries is returned from the kernel
+    int ready;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (ready)
+        : "g" (SYSCALL_MSG_SELECT), "g" (sel)
+        : "eax", "ebx");
+
+    return ready;
+}
+
+int mbox_create(int capacity, int msg_size) {
+    //trigger the system call
+    //capacity and message size are sent to the kernel
+    //mailbox handle is returned from the kernel
+    int mbox;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (mbox)
+        : "g" (SYSCALL_MBOX_CREATE), "g" (capacity), "g" (msg_size)
+        : "eax", "ebx", "ecx");
+
+    return mbox;
+}
+
+int mbox_destroy(int mbox) {
+    return handle_destroy(mbox, HANDLE_MBOX);
+}
+
+int ipc_call(int server, ipc_regs_t *regs) {
+    //trigger the system call
+    //server pid is sent in ebx, message words in ecx/edx/esi/edi
+    //status is returned in ebx, reply words in ecx/edx/esi/edi
+    //register constraints are used since every general register is in use
+    int rc = server;
+    int w0 = regs->w[0];
+    int w1 = regs->w[1];
+    int w2 = regs->w[2];
+    int w3 = regs->w[3];
+
+    asm volatile("int $0x80;"
+        : "+b" (rc), "+c" (w0), "+d" (w1), "+S" (w2), "+D" (w3)
+        : "a" (SYSCALL_IPC_CALL)
+        : "memory");
+
+    regs->w[0] = w0;
+    regs->w[1] = w1;
+    regs->w[2] = w2;
+    regs->w[3] = w3;
+
+    return rc;
+}
+
+int ipc_reply_wait(int client, ipc_regs_t *regs) {
+    //trigger the system call
+    //client pid is sent in ebx, reply words in ecx/edx/esi/edi
+    //next caller pid is returned in ebx, call words in ecx/edx/esi/edi
+    int caller = client;
+    int w0 = regs->w[0];
+    int w1 = regs->w[1];
+    int w2 = regs->w[2];
+    int w3 = regs->w[3];
+
+    asm volatile("int $0x80;"
+        : "+b" (caller), "+c" (w0), "+d" (w1), "+S" (w2), "+D" (w3)
+        : "a" (SYSCALL_IPC_REPLY_WAIT)
+        : "memory");
+
+    regs->w[0] = w0;
+    regs->w[1] = w1;
+    regs->w[2] = w2;
+    regs->w[3] = w3;
+
+    return caller;
+}
+
+int chan_create(int policy) {
+    //trigger the system call
+    //full-channel policy is sent to the kernel
+    //channel identifier is returned from the kernel
+    int chan;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (chan)
+        : "g" (SYSCALL_CHAN_CREATE), "g" (policy)
+        : "eax", "ebx");
+
+    return chan;
+}
+
+int chan_subscribe(int chan) {
+    //trigger the system call
+    //channel identifier is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_CHAN_SUBSCRIBE), "g" (chan)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int chan_unsubscribe(int chan) {
+    //trigger the system call
+    //channel identifier is sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_CHAN_UNSUBSCRIBE), "g" (chan)
+        : "eax", "ebx");
+
+    return rc;
+}
+
+int chan_publish(msg_t *msg, int chan) {
+    //trigger the system call
+    //pointer to msg and channel identifier are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_CHAN_PUBLISH), "g" (msg), "g" (chan)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int chan_recv(msg_t *msg, int chan) {
+    //trigger the system call
+    //pointer to msg and channel identifier are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_CHAN_RECV), "g" (msg), "g" (chan)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int futex_wait(int *addr, int expected) {
+    //trigger the system call
+    //address and expected value are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_FUTEX_WAIT), "g" (addr), "g" (expected)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int futex_wake(int *addr, int count) {
+    //trigger the system call
+    //address and number of processes to wake are sent to the kernel
+    //number of processes woken is returned from the kernel
+    int woken;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (woken)
+        : "g" (SYSCALL_FUTEX_WAKE), "g" (addr), "g" (count)
+        : "eax", "ebx", "ecx");
+
+    return woken;
+}
+
+/**
+ * Atomically replaces *ptr with new_val if it currently holds old_val
+ * @return the value *ptr held before the operation
+ */
+int atomic_cmpxchg(volatile int *ptr, int old_val, int new_val) {
+    int prev;
+
+    asm volatile("lock; cmpxchgl %2, %1;"
+        : "=a" (prev), "+m" (*ptr)
+        : "r" (new_val), "0" (old_val)
+        : "memory");
+
+    return prev;
+}
+
+/**
+ * Atomically adds delta to *ptr
+ */
+void atomic_add(volatile int *ptr, int delta) {
+    asm volatile("lock; addl %1, %0;"
+        : "+m" (*ptr)
+        : "ir" (delta)
+        : "memory");
+}
+
+void fsem_init(fsem_t *sem, int value) {
+    sem->value = value;
+    sem->waiters = 0;
+}
+
+int fsem_trywait(fsem_t *sem) {
+    int value;
+
+    //take a permit if one is available, without entering the kernel
+    while ((value = sem->value) > 0) {
+        if (atomic_cmpxchg(&sem->value, value, value - 1) == value) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void fsem_wait(fsem_t *sem) {
+    while (fsem_trywait(sem) != 0) {
+        //no permits: sleep until a post changes the value from 0
+        //the kernel rechecks the value, so a post between our check
+        //and the sleep makes futex_wait return straight away
+        atomic_add(&sem->waiters, 1);
+        futex_wait((int *)&sem->value, 0);
+        atomic_add(&sem->waiters, -1);
+    }
+}
+
+void fsem_post(fsem_t *sem) {
+    atomic_add(&sem->value, 1);
+
+    //only enter the kernel if somebody is asleep
+    if (sem->waiters > 0) {
+        futex_wake((int *)&sem->value, 1);
+    }
+}
+
+int handle_destroy(int handle, int type) {
+    //trigger the system call
+    //handle and object type are sent to the kernel
+    //status is returned from the kernel
+    int rc;
+
+    asm("movl %1, %%eax;"
+        "movl %2, %%ebx;"
+        "movl %3, %%ecx;"
+        "int $0x80;"
+        "movl %%ebx, %0;"
+        : "=g" (rc)
+        : "g" (SYSCALL_HANDLE_DESTROY), "g" (handle), "g" (type)
+        : "eax", "ebx", "ecx");
+
+    return rc;
+}
+
+int handle_release(int *handle, int type) {
+    //destroy the object, then mark the variable uninitialized so it can
+    //be passed to its init call again
+    int rc = handle_destroy(*handle, type);
+
+    if (rc == 0) {
+        *handle = SEMAPHORE_UNINITIALIZED;
+    }
+    return rc;
+}
+
+int sem_destroy(sem_t *sem) {
+    return handle_release(sem, HANDLE_SEMAPHORE);
+}
+
+int mutex_destroy(sem_t *mutex) {
+    return handle_release(mutex, HANDLE_MUTEX);
+}
+
+int cond_destroy(cond_t *cond) {
+    return handle_release(cond, HANDLE_COND);
+}
+
+int rwlock_destroy(rwlock_t *rwlock) {
+    return handle_release(rwlock, HANDLE_RWLOCK);
+}
+
+int event_destroy(event_t *event) {
+    return handle_release(event, HANDLE_EVENT);
+}
+
+int chan_destroy(int chan) {
+    return handle_destroy(chan, HANDLE_CHAN);
 }
@@ -3,6 +3,16 @@
 
 // IPC data structures (needed for forward declarations below)
 #include "ipc.h"
+#include "khandle.h"
+#include "kirq.h"
+#include "kcons.h"
+#include "kserial.h"
+#include "kbcache.h"
+#include "kfs.h"
+#include "kaio.h"
+#include "ktrace.h"
+#include "kprof.h"
+#include "kproc.h"
 
 /*
  * Forces a process to exit
@@ -36,42 +46,602 @@ int get_proc_name(char *name);
 void sleep(int seconds);
 
 /*
- * Initialize a semaphore
+ * Obtains the time since boot with nanosecond resolution
+ * @param ts - destination for the seconds and nanoseconds
+ */
+void clock_gettime(timespec_t *ts);
+
+/*
+ * Sleeps for at least the requested interval
+ * @param req - interval to sleep (tv_nsec from 0 to 999999999)
+ * @return 0 on success, -1 if the interval is invalid
+ */
+int nanosleep(const timespec_t *req);
+
+/*
+ * Sleeps for at least the given number of milliseconds
+ * @param ms - number of milliseconds to sleep
+ * @return 0 on success, -1 if ms is negative
+ */
+int msleep(int ms);
+
+/*
+ * Create a periodic timer. Each time the period elapses a message from
+ * MSG_SENDER_TIMER carrying a timer_msg_t is posted to the mailbox. While
+ * that message is unreceived, later expiries are folded into it and
+ * reported in its expirations count.
+ * @param period_ms - interval between expiries in milliseconds
+ * @param mbox - mailbox handle; its message size must fit a timer_msg_t
+ * @return timer handle, -1 on error
+ */
+int timer_create(int period_ms, int mbox);
+
+/*
+ * Destroy a timer
+ * @param timer - timer handle
+ * @return 0 on success, -1 if the handle is stale
+ */
+int timer_destroy(int timer);
+
+/*
+ * Change the timer interrupt frequency for the whole system
+ * Lower rates cost fewer interrupts; higher rates give finer sleeps and
+ * scheduling. The scheduling quantum keeps the same length in time.
+ * @param hz - timer interrupts per second (19 to 10000)
+ * @return 0 on success, -1 if hz is out of range
+ */
+int set_tick_hz(int hz);
+
+/*
+ * Set how late the caller's sleeps and timeouts may end so that they can
+ * share a wakeup with another process
+ * @param slack_us - slack in microseconds (0 to 1000000)
+ * @return 0 on success, -1 if the slack is out of range
+ */
+int set_timer_slack(int slack_us);
+
+/*
+ * Obtain the interrupt count and handler run time of an IRQ line
+ * @param irq - IRQ line (0 to IRQ_MAX - 1)
+ * @param stats - destination for the statistics
+ * @return 0 on success, -1 if the line is invalid
+ */
+int irq_stats(int irq, irq_stats_t *stats);
+
+/*
+ * Reads a key from the keyboard, waiting for one to be pressed; keys bound
+ * to kernel debug commands are never returned
+ * @return the ASCII value of the key
+ */
+int read_key(void);
+
+/*
+ * Buffers a record for the console task to write out
+ * @param record - characters to write
+ * @param len - number of characters (at most CONS_RECORD_MAX)
+ * @return number of characters buffered, -1 if the record was dropped
+ */
+int cons_write(const char *record, int len);
+
+/*
+ * Formats a record like cons_printf() and buffers it for the console task
+ * without waiting for it to be displayed
+ * @param format - printf style format string
+ * @return number of characters buffered, -1 if the record was dropped or
+ *         is CONS_RECORD_MAX characters or longer
+ */
+int cons_log(const char *format, ...);
+
+/*
+ * Reads from the serial port (COM1)
+ * @param buf - destination buffer
+ * @param len - size of the buffer
+ * @param flags - SERIAL_NONBLOCK to return at once when no data is available
+ * @return number of bytes read (at least 1 unless SERIAL_NONBLOCK is set),
+ *         -1 on error
+ */
+int serial_read(char *buf, int len, int flags);
+
+/*
+ * Writes to the serial port (COM1)
+ * @param buf - data to send
+ * @param len - number of bytes to send
+ * @param flags - SERIAL_NONBLOCK to queue only what fits without waiting
+ * @return number of bytes queued for transmission, -1 on error
+ */
+int serial_write(const char *buf, int len, int flags);
+
+/*
+ * Reads a disk block through the buffer cache
+ * @param block - block number
+ * @param buf - destination of BLOCK_SIZE bytes
+ * @return 0 on success, -1 if the block does not exist or the read failed
+ */
+int blk_read(int block, void *buf);
+
+/*
+ * Writes a disk block through the buffer cache; the block reaches the disk
+ * later unless blk_sync() is called
+ * @param block - block number
+ * @param buf - BLOCK_SIZE bytes to write
+ * @return 0 on success, -1 if the block does not exist
+ */
+int blk_write(int block, const void *buf);
+
+/*
+ * Writes every modified block to disk
+ * @return 0 once they have been written
+ */
+int blk_sync(void);
+
+/*
+ * Opens a file in the in-memory file system
+ * @param name - file name (shorter than FS_NAME_LEN)
+ * @param flags - FS_O_CREAT, FS_O_TRUNC and FS_O_APPEND or-ed together
+ * @return file handle, -1 if the file does not exist or cannot be opened
+ */
+int fs_open(const char *name, int flags);
+
+/*
+ * Reads from the current position of a file
+ * @param fd - file handle
+ * @param buf - destination buffer
+ * @param len - most bytes to read
+ * @return number of bytes read (0 at the end of the file), -1 on error
+ */
+int fs_read(int fd, void *buf, int len);
+
+/*
+ * Writes at the current position of a file (its end with FS_O_APPEND)
+ * @param fd - file handle
+ * @param buf - data to write
+ * @param len - number of bytes to write
+ * @return number of bytes written, -1 if nothing could be written
+ */
+int fs_write(int fd, const void *buf, int len);
+
+/*
+ * Closes a file, ending any mapping made through it
+ * @param fd - file handle
+ * @return 0 on success, -1 if the handle is invalid
+ */
+int fs_close(int fd);
+
+/*
+ * Maps part of a file so it can be read and written in place
+ * @param fd - file handle
+ * @param offset - start of the mapping (a multiple of FS_PAGE_SIZE)
+ * @param len - length of the mapping (within the file)
+ * @return address of the file data at offset, NULL if it cannot be mapped
+ */
+void *fs_mmap(int fd, int offset, int len);
+
+/*
+ * Removes a file; open handles keep working until they are closed
+ * @param name - file name
+ * @return 0 on success, -1 if there is no such file
+ */
+int fs_unlink(const char *name);
+
+/*
+ * Starts a read or write without waiting for it; an aio_completion_t
+ * message from MSG_SENDER_AIO is posted to req->mbox when it finishes
+ * @param req - operation to start (copied; req->buf must stay valid)
+ * @return 0 if the operation was started, -1 if it is invalid, AIO_MAX
+ *         operations are outstanding or the mailbox has no room for the
+ *         completion
+ */
+int aio_submit(aio_req_t *req);
+
+/*
+ * Enables kernel trace categories
+ * @param mask - TRACE_* categories to record (0 stops tracing), or -1 to
+ *               leave them unchanged
+ * @return the categories that were enabled
+ */
+int trace_ctl(int mask);
+
+/*
+ * Moves recorded trace events into a buffer, oldest first; the first
+ * event is always a TRACE_EV_CLOCK record
+ * @param events - destination buffer
+ * @param count - number of events the buffer holds
+ * @return number of events copied, -1 if count is less than 1
+ */
+int trace_read(trace_event_t *events, int count);
+
+/*
+ * Starts or stops sampling the running code on each timer tick
+ * @param enable - 1 to start, 0 to stop, -1 to leave it unchanged
+ * @return 1 if sampling was enabled, 0 otherwise
+ */
+int prof_ctl(int enable);
+
+/*
+ * Moves recorded profiler samples into a buffer, oldest first
+ * @param samples - destination buffer
+ * @param count - number of samples the buffer holds
+ * @return number of samples copied, -1 if count is negative
+ */
+int prof_read(prof_sample_t *samples, int count);
+
+/*
+ * Waits until a process has console output pending (console task only)
+ * @return 0 when there is output, -1 if the caller is not the console task
+ */
+int cons_wait(void);
+
+/*
+ * Initialize a counting semaphore
  * @param sem - pointer to the semaphore identifier
- * @return none
+ * @param value - initial number of permits
+ * @return 0 on success, -1 if no semaphores are available
  */
-void sem_init(sem_t *sem);
+int sem_init(sem_t *sem, int value);
 
 /*
- * Waits on a semaphore to be posted
+ * Takes a permit, waiting for a post if none are available
  * @param sem - pointer to the semaphore identifier
- * @return none
+ * @return 0 on success, -1 if the semaphore is invalid or was destroyed
  */
-void sem_wait(sem_t *sem);
+int sem_wait(sem_t *sem);
 
 /*
- * Posts a semaphore
+ * Takes a permit if one is available; never blocks
  * @param sem - pointer to the semaphore identifier
- * @return none
+ * @return 0 if a permit was taken, -1 otherwise
+ */
+int sem_trywait(sem_t *sem);
+
+/*
+ * Takes a permit, waiting at most timeout_ms milliseconds for a post
+ * @param sem - pointer to the semaphore identifier
+ * @param timeout_ms - longest time to wait (rounded up to timer ticks)
+ * @return 0 if a permit was taken, -1 if the timeout expired
  */
-void sem_post(sem_t *sem);
+int sem_timedwait(sem_t *sem, int timeout_ms);
+
+/*
+ * Returns a permit, handing it straight to a waiting process if any
+ * @param sem - pointer to the semaphore identifier
+ * @return 0 on success, -1 if the semaphore is invalid
+ */
+int sem_post(sem_t *sem);
+
+/*
+ * Destroy a semaphore; processes waiting on it are woken with an error
+ * The identifier is reset so that it may be passed to sem_init() again.
+ * @param sem - pointer to the semaphore identifier
+ * @return 0 on success, -1 if the semaphore is invalid
+ */
+int sem_destroy(sem_t *sem);
+
+/*
+ * Initialize a mutex
+ * @param mutex - pointer to the mutex identifier
+ * @return 0 on success, -1 if no mutexes are available
+ */
+int mutex_init(sem_t *mutex);
+
+/*
+ * Lock a mutex, waiting for the owner to unlock it if necessary
+ * While waiting, the owner runs at no less than the caller's priority.
+ * @param mutex - pointer to the mutex identifier
+ * @return 0 on success, -1 if the mutex is invalid or already held
+ */
+int mutex_lock(sem_t *mutex);
+
+/*
+ * Unlock a mutex held by the caller
+ * @param mutex - pointer to the mutex identifier
+ * @return 0 on success, -1 if the caller does not own the mutex
+ */
+int mutex_unlock(sem_t *mutex);
+
+/*
+ * Destroy a mutex; processes waiting on it are woken with an error
+ * @param mutex - pointer to the mutex identifier
+ * @return 0 on success, -1 if the mutex is invalid
+ */
+int mutex_destroy(sem_t *mutex);
+
+/*
+ * Initialize a condition variable
+ * @param cond - pointer to the condition identifier
+ * @return 0 on success, -1 if no condition variables are available
+ */
+int cond_init(cond_t *cond);
+
+/*
+ * Atomically unlock the mutex and wait for the condition to be signaled
+ * The mutex is locked again before the call returns.
+ * @param cond - pointer to the condition identifier
+ * @param mutex - pointer to a mutex held by the caller
+ * @return 0 on success, -1 if the caller does not own the mutex
+ */
+int cond_wait(cond_t *cond, sem_t *mutex);
+
+/*
+ * Wake one process waiting on a condition
+ * @param cond - pointer to the condition identifier
+ * @return 0 on success, -1 on error
+ */
+int cond_signal(cond_t *cond);
+
+/*
+ * Wake every process waiting on a condition
+ * @param cond - pointer to the condition identifier
+ * @return 0 on success, -1 on error
+ */
+int cond_broadcast(cond_t *cond);
+
+/*
+ * Destroy a condition variable; waiting processes return -1 from
+ * cond_wait() without the mutex
+ * @param cond - pointer to the condition identifier
+ * @return 0 on success, -1 if the condition variable is invalid
+ */
+int cond_destroy(cond_t *cond);
+
+/*
+ * Initialize a reader-writer lock
+ * @param rwlock - pointer to the lock identifier
+ * @return 0 on success, -1 if no locks are available
+ */
+int rwlock_init(rwlock_t *rwlock);
+
+/*
+ * Take a shared read lock; readers do not block one another
+ * @param rwlock - pointer to the lock identifier
+ * @return 0 on success, -1 on error
+ */
+int rwlock_rdlock(rwlock_t *rwlock);
+
+/*
+ * Take the exclusive write lock
+ * @param rwlock - pointer to the lock identifier
+ * @return 0 on success, -1 on error
+ */
+int rwlock_wrlock(rwlock_t *rwlock);
+
+/*
+ * Release a read or write lock held by the caller
+ * @param rwlock - pointer to the lock identifier
+ * @return 0 on success, -1 if the caller holds no lock
+ */
+int rwlock_unlock(rwlock_t *rwlock);
+
+/*
+ * Destroy a reader-writer lock; waiting processes are woken with an error
+ * @param rwlock - pointer to the lock identifier
+ * @return 0 on success, -1 if the lock is invalid
+ */
+int rwlock_destroy(rwlock_t *rwlock);
+
+/*
+ * Initialize an event flag group with every flag clear
+ * @param event - pointer to the event identifier
+ * @return 0 on success, -1 if no event flag groups are available
+ */
+int event_init(event_t *event);
+
+/*
+ * Set flags, waking every process whose wait is now satisfied
+ * @param event - pointer to the event identifier
+ * @param mask - flags to set
+ * @return number of processes woken, -1 on error
+ */
+int event_set(event_t *event, unsigned int mask);
+
+/*
+ * Clear flags
+ * @param event - pointer to the event identifier
+ * @param mask - flags to clear
+ * @return 0 on success, -1 on error
+ */
+int event_clear(event_t *event, unsigned int mask);
+
+/*
+ * Wait for flags to be set
+ * @param event - pointer to the event identifier
+ * @param mask - flags to wait for
+ * @param mode - EVENT_WAIT_ANY or EVENT_WAIT_ALL, optionally or-ed with
+ *        EVENT_WAIT_CLEAR to clear the mask bits when the wait completes
+ * @param flags - set to the flag word that satisfied the wait (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int event_wait(event_t *event, unsigned int mask, int mode, unsigned int *flags);
+
+/*
+ * Destroy an event flag group; waiting processes are woken with an error
+ * @param event - pointer to the event identifier
+ * @return 0 on success, -1 if the event flag group is invalid
+ */
+int event_destroy(event_t *event);
+
+/*
+ * Set the running process' scheduling priority
+ * @param prio - priority from 0 (lowest) to PROC_PRIO_MAX-1
+ * @return 0 on success, -1 on error
+ */
+int set_proc_prio(int prio);
+
+/*
+ * Copies the process table, one entry per process in use
+ * @param buf - destination buffer
+ * @param max - number of entries the buffer holds (PROC_MAX is enough)
+ * @return number of entries copied, -1 if max is negative
+ */
+int proc_snapshot(proc_stat_t *buf, int max);
 
 /*
  * Send a message to the specified mailbox
+ * Only the mailbox's msg_size bytes of msg->data are copied.
+ * Messages are received highest msg->priority first, and in the order
+ * they were sent within a priority.
  * @param  msg - pointer to the message data structure for the
  *         message to be sent
- * @param  mailbox - mailbox number
- * @return none
+ * @param  mailbox - mailbox handle
+ * @return 0 on success, -1 if the mailbox is full or the handle is stale
  */
-void msg_send(msg_t *msg, int mbox_num);
+int msg_send(msg_t *msg, int mbox_num);
 
 /*
  * Receive a message from the specified mailbox
+ * Only the mailbox's msg_size bytes of msg->data are written.
  * @param  msg - pointer to the message data structure for the
  *         received message
- * @param  mailbox - mailbox number
+ * @param  mailbox - mailbox handle
+ * @return 0 on success, -1 if the handle is stale or the mailbox
+ *         was destroyed while waiting
+ */
+int msg_recv(msg_t *msg, int mbox_num);
+
+/*
+ * Wait until any mailbox or semaphore in the select set is ready.
+ * The mbox_ready[]/sem_ready[] flags are set for every ready entry; a
+ * ready mailbox is then read with msg_recv() and a ready semaphore
+ * taken with sem_wait().
+ * @param  sel - pointer to the select set
+ * @return number of ready entries, -1 if an entry is stale or appears
+ *         twice in the set
+ */
+int msg_select(msg_select_t *sel);
+
+/*
+ * Create a mailbox
+ * @param  capacity - maximum number of queued messages
+ * @param  msg_size - bytes of message data carried by each message
+ *         (1 to MSG_SIZE)
+ * @return mailbox handle, -1 on error
+ */
+int mbox_create(int capacity, int msg_size);
+
+/*
+ * Destroy a mailbox; processes waiting on it are woken with an error
+ * @param  mbox - mailbox handle
+ * @return 0 on success, -1 if the handle is stale
+ */
+int mbox_destroy(int mbox);
+
+/*
+ * Synchronous call: send a register message to a server process and
+ * block until it replies. The reply overwrites regs.
+ * @param  server - pid of the server process
+ * @param  regs - message words to send; reply words on return
+ * @return 0 on success, -1 if the server is invalid or exited
+ */
+int ipc_call(int server, ipc_regs_t *regs);
+
+/*
+ * Reply to a client and wait for the next call in one step.
+ * @param  client - pid of the client to reply to, -1 to only wait
+ * @param  regs - reply words to send; the next call's words on return
+ * @return pid of the next caller, -1 if client was not awaiting a reply
+ */
+int ipc_reply_wait(int client, ipc_regs_t *regs);
+
+/*
+ * Sleep on a user address if it still holds the expected value
+ * @param  addr - address to wait on
+ * @param  expected - value *addr must hold for the process to sleep
+ * @return 0 once woken, -1 if *addr no longer held expected
+ */
+int futex_wait(int *addr, int expected);
+
+/*
+ * Wake processes sleeping on a user address
+ * @param  addr - address to wake
+ * @param  count - maximum number of processes to wake
+ * @return number of processes woken
+ */
+int futex_wake(int *addr, int count);
+
+/*
+ * Initialize a futex semaphore
+ * @param  sem - pointer to the semaphore
+ * @param  value - initial number of permits
+ * @return none
+ */
+void fsem_init(fsem_t *sem, int value);
+
+/*
+ * Take a permit from a futex semaphore without blocking
+ * @param  sem - pointer to the semaphore
+ * @return 0 if a permit was taken, -1 if none were available
+ */
+int fsem_trywait(fsem_t *sem);
+
+/*
+ * Take a permit from a futex semaphore, sleeping until one is available
+ * Enters the kernel only when there are no permits.
+ * @param  sem - pointer to the semaphore
  * @return none
  */
-void msg_recv(msg_t *msg, int mbox_num);
+void fsem_wait(fsem_t *sem);
+
+/*
+ * Return a permit to a futex semaphore
+ * Enters the kernel only when a process is sleeping on it.
+ * @param  sem - pointer to the semaphore
+ * @return none
+ */
+void fsem_post(fsem_t *sem);
+
+/*
+ * Create a broadcast channel
+ * @param  policy - CHAN_DROP_OLDEST or CHAN_BLOCK_PUBLISHER, applied
+ *         when a slow subscriber leaves the channel full
+ * @return channel handle, -1 on error
+ */
+int chan_create(int policy);
+
+/*
+ * Subscribe to messages published to a channel from now on
+ * @param  chan - channel identifier
+ * @return 0 on success, -1 on error
+ */
+int chan_subscribe(int chan);
+
+/*
+ * Unsubscribe from a channel, discarding unread messages
+ * @param  chan - channel identifier
+ * @return 0 on success, -1 on error
+ */
+int chan_unsubscribe(int chan);
+
+/*
+ * Publish a message to every subscriber of a channel
+ * The message is stored once no matter how many subscribers there are.
+ * @param  msg - pointer to the message to publish
+ * @param  chan - channel identifier
+ * @return 0 on success, -1 on error
+ */
+int chan_publish(msg_t *msg, int chan);
+
+/*
+ * Receive the next message published to a subscribed channel
+ * @param  msg - pointer to the received message
+ * @param  chan - channel identifier
+ * @return 0 on success, -1 on error
+ */
+int chan_recv(msg_t *msg, int chan);
+
+/*
+ * Destroy a broadcast channel; blocked subscribers and publishers are
+ * woken with an error
+ * @param  chan - channel handle
+ * @return 0 on success, -1 if the handle is stale
+ */
+int chan_destroy(int chan);
+
+/*
+ * Destroy any kernel object by handle. Objects are also destroyed when
+ * the process that created them exits.
+ * @param  handle - handle to destroy
+ * @param  type - kind of object the handle names (HANDLE_SEMAPHORE, ...)
+ * @return 0 on success, -1 if the handle is stale or of another type
+ */
+int handle_destroy(int handle, int type);
 
 #endif
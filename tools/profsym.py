@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Symbolizes profiler samples against the kernel image.
+
+The dump is what prof_proc writes to COM1 (press 'r' on the target to start
+sampling and 'f' to dump the samples), captured on the host, e.g. with
+QEMU's -serial file:prof.txt.
+
+    tools/profsym.py prof.txt                 flat profile of all samples
+    tools/profsym.py --by-pid prof.txt        flat profile per process
+    tools/profsym.py --folded prof.txt        folded stacks (pid;function)
+
+The folded output feeds flamegraph.pl or speedscope directly.
+"""
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+# PROF_PID_KERNEL in kprof.h
+PID_KERNEL = -1
+
+
+def load_symbols(image, nm):
+    """Returns sorted (addresses, names) of the text symbols in the image."""
+    output = subprocess.run([nm, "-n", image], check=True,
+                            stdout=subprocess.PIPE, universal_newlines=True).stdout
+    addrs = []
+    names = []
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) != 3 or fields[1] not in "tTwW":
+            continue
+        addrs.append(int(fields[0], 16))
+        names.append(fields[2])
+    return addrs, names
+
+
+def symbolize(addrs, names, eip):
+    i = bisect.bisect_right(addrs, eip) - 1
+    if i < 0:
+        return "0x%08x" % eip
+    return names[i]
+
+
+def parse(lines):
+    """Yields (pid, eip) for each sample line of the dump."""
+    for line in lines:
+        fields = line.split()
+        if len(fields) != 3 or fields[0] != "sample":
+            continue
+        yield int(fields[1]), int(fields[2], 16)
+
+
+def process_name(pid):
+    return "kernel" if pid == PID_KERNEL else "pid %d" % pid
+
+
+def print_flat(counts, total, out):
+    out.write("%8s %7s  %s\n" % ("samples", "%", "function"))
+    for name, count in counts.most_common():
+        out.write("%8d %6.2f%%  %s\n" % (count, 100.0 * count / total, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", nargs="?", help="profiler dump (default: stdin)")
+    parser.add_argument("--image", default="MyOS.dli", help="kernel image (default: MyOS.dli)")
+    parser.add_argument("--nm", default="nm", help="nm to read the image with (default: nm)")
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument("--by-pid", action="store_true", help="one flat profile per process")
+    group.add_argument("--folded", action="store_true", help="folded stacks output")
+    args = parser.parse_args()
+
+    addrs, names = load_symbols(args.image, args.nm)
+
+    source = open(args.dump) if args.dump else sys.stdin
+    with source:
+        samples = [(pid, symbolize(addrs, names, eip)) for pid, eip in parse(source)]
+
+    if not samples:
+        sys.stderr.write("no samples in the dump\n")
+        return 1
+
+    out = sys.stdout
+    if args.folded:
+        folded = collections.Counter("%s;%s" % (process_name(pid), name) for pid, name in samples)
+        for stack, count in sorted(folded.items()):
+            out.write("%s %d\n" % (stack, count))
+    elif args.by_pid:
+        by_pid = collections.defaultdict(collections.Counter)
+        for pid, name in samples:
+            by_pid[pid][name] += 1
+        for pid in sorted(by_pid):
+            total = sum(by_pid[pid].values())
+            out.write("%s: %d samples\n" % (process_name(pid), total))
+            print_flat(by_pid[pid], total, out)
+            out.write("\n")
+    else:
+        print_flat(collections.Counter(name for pid, name in samples), len(samples), out)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
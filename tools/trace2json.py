@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Converts a kernel trace dump into Chrome trace JSON.
+
+The dump is what trace_proc writes to COM1 (press 't' on the target to start
+tracing and 'd' to dump it), captured on the host, e.g. with QEMU's
+-serial file:trace.txt. Open the output in chrome://tracing or Perfetto.
+
+    tools/trace2json.py trace.txt > trace.json
+"""
+import json
+import sys
+
+# trace_event_e in ktrace.h
+EV_CLOCK = 0
+EV_SCHED_IN = 1
+EV_SCHED_OUT = 2
+EV_WAKE = 3
+EV_SEM_BLOCK = 4
+EV_SEM_WAKE = 5
+EV_MBOX_BLOCK = 6
+EV_MBOX_WAKE = 7
+EV_IRQ_ENTER = 8
+EV_IRQ_EXIT = 9
+
+# Process states in kernel.h, as recorded by EV_SCHED_OUT
+STATES = ["AVAILABLE", "READY", "RUNNING", "SLEEPING", "WAITING"]
+
+INSTANTS = {
+    EV_WAKE: ("wake", None),
+    EV_SEM_BLOCK: ("sem block", "sem"),
+    EV_SEM_WAKE: ("sem wake", "sem"),
+    EV_MBOX_BLOCK: ("mbox block", "mbox"),
+    EV_MBOX_WAKE: ("mbox wake", "mbox"),
+}
+
+# Thread id the interrupt handlers are drawn on
+IRQ_TID = 1000
+
+
+def parse(lines):
+    """Yields (type, pid, arg, cycles) for each event line of the dump."""
+    for line in lines:
+        fields = line.split()
+        if len(fields) != 5 or fields[0] != "ev":
+            continue
+        yield int(fields[1]), int(fields[2]), int(fields[3]), int(fields[4], 16)
+
+
+def convert(events):
+    """Returns the Chrome trace for the events, None if none could be placed."""
+    out = []
+    khz = None
+    base = None
+    lost = 0
+
+    for etype, pid, arg, cycles in events:
+        if etype == EV_CLOCK:
+            khz = arg or khz
+            lost += pid
+            continue
+        if khz is None:
+            continue
+        if base is None:
+            base = cycles
+
+        ev = {"pid": 0, "tid": pid, "ts": (cycles - base) * 1000.0 / khz}
+
+        if etype == EV_SCHED_IN:
+            ev.update(name="run", ph="B")
+        elif etype == EV_SCHED_OUT:
+            state = STATES[arg] if 0 <= arg < len(STATES) else str(arg)
+            ev.update(name="run", ph="E", args={"state": state})
+        elif etype in (EV_IRQ_ENTER, EV_IRQ_EXIT):
+            ev.update(name="irq %d" % arg, tid=IRQ_TID,
+                      ph="B" if etype == EV_IRQ_ENTER else "E",
+                      args={"interrupted": pid})
+        elif etype in INSTANTS:
+            name, key = INSTANTS[etype]
+            ev.update(name=name, ph="i", s="t")
+            if key:
+                ev["args"] = {key: arg}
+        else:
+            continue
+
+        out.append(ev)
+
+    pids = sorted(set(ev["tid"] for ev in out if ev["tid"] != IRQ_TID))
+    meta = [{"name": "thread_name", "ph": "M", "pid": 0, "tid": pid,
+             "args": {"name": "pid %d" % pid}} for pid in pids]
+    meta.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": IRQ_TID,
+                 "args": {"name": "irq"}})
+
+    if lost:
+        sys.stderr.write("warning: %d events were overwritten before the dump\n" % lost)
+
+    if not out:
+        return None
+    return {"traceEvents": meta + out, "displayTimeUnit": "ns"}
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.stderr.write("usage: %s [dump]\n" % sys.argv[0])
+        return 1
+
+    source = open(sys.argv[1]) if len(sys.argv) == 2 else sys.stdin
+    with source:
+        trace = convert(parse(source))
+
+    if trace is None:
+        sys.stderr.write("no events (or no calibrated clock record) in the dump\n")
+        return 1
+
+    json.dump(trace, sys.stdout)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -20,14 +20,18 @@ typedef struct proc_info_t {
     char name[PROC_NAME_LEN];
 } proc_info_t;
 
-/* "Shared" memory */
-int shared_mem;
+/* "Shared" memory: pid of the last process to report, -1 until one has */
+int shared_mem = -1;
 
-/* Mailbox number to send messages */
-int mbox_num = 1;
+/* Mailbox to send messages (created by the dispatcher) */
+int mbox_num = -1;
 
-/* Semaphore */
-sem_t sem = SEMAPHORE_UNINITIALIZED;
+/* Mutex guarding shared_mem, and condition signaled when it changes */
+sem_t shared_lock = SEMAPHORE_UNINITIALIZED;
+cond_t shared_cond = SEMAPHORE_UNINITIALIZED;
+
+/* Posted once shared_lock and shared_cond are set up; needs no setup itself */
+fsem_t shared_ready = FSEM_INITIALIZER(0);
 
 void user_proc() {
     int pid;
@@ -58,13 +62,13 @@ void user_proc() {
     // Set the message data for the proc_info_t struct
     sp_memcpy(msg.data, &proc_info, sizeof(proc_info_t));
 
-    cons_printf("time=%04d pid=%02d %s started\n", start_time, pid, name);
+    cons_log("time=%04d pid=%02d %s started\n", start_time, pid, name);
 
     while (1) {
         time = get_sys_time();
 
         if (time - start_time >= 10) {
-            cons_printf("time=%04d pid=%02d %s exiting\n", time, pid, name);
+            cons_log("time=%04d pid=%02d %s exiting\n", time, pid, name);
             msg_send(&msg, mbox_num);
             proc_exit();
         }
@@ -88,9 +92,18 @@ void dispatcher_proc() {
     pid  = get_proc_pid();
     time = get_sys_time();
 
-    sem_init(&sem);
+    // Create the mailbox that user processes report to
+    mbox_num = mbox_create(PROC_MAX, sizeof(proc_info_t));
+
+    // Post a tick to the same mailbox once a second to keep time current
+    timer_create(1000, mbox_num);
+
+    // Set up the shared memory lock for both, then let the printer use it
+    mutex_init(&shared_lock);
+    cond_init(&shared_cond);
+    fsem_post(&shared_ready);
 
-    cons_printf("time=%04d pid=%02d %s started\n", time, pid, name);
+    cons_log("time=%04d pid=%02d %s started\n", time, pid, name);
 
     while (1) {
         // Clear out the message data structure
@@ -100,26 +113,32 @@ void dispatcher_proc() {
         // Receive a message from the mailbox
         msg_recv(&msg, mbox_num);
 
+        if (msg.sender == MSG_SENDER_TIMER) {
+            time = get_sys_time();
+            continue;
+        }
+
         sp_memcpy(&proc_info, msg.data, sizeof(proc_info_t));
 
-        cons_printf("time=%04d pid=%02d %s received msg(sender=%d, sent=%d, received=%d)\n",
-                    time, pid, name, msg.sender, msg.time_sent, msg.time_received);
-        cons_printf("time=%04d pid=%02d %s received data=(name=%s, start=%d, sleep=%d)\n",
-                    time, pid, name, proc_info.name, proc_info.time_start, proc_info.time_sleep);
+        cons_log("time=%04d pid=%02d %s received msg(sender=%d, sent=%d.%06d, received=%d.%06d)\n",
+                 time, pid, name, msg.sender,
+                 msg.time_sent, msg.time_sent_nsec / 1000,
+                 msg.time_received, msg.time_received_nsec / 1000);
+        cons_log("time=%04d pid=%02d %s received data=(name=%s, start=%d, sleep=%d)\n",
+                 time, pid, name, proc_info.name, proc_info.time_start, proc_info.time_sleep);
 
         // Get the current system time
         time = get_sys_time();
 
-        // Wait for the semaphore to be posted by the printer process
-        sem_wait(&sem);
+        // Lock the shared memory
+        mutex_lock(&shared_lock);
 
         // Set the shared memory
         shared_mem = proc_info.pid;
 
-        // Post the semaphore so the printer process can access the shared memory
-        sem_post(&sem);
-
-        sleep(1);
+        // Wake the printer process now that there is new data
+        cond_signal(&shared_cond);
+        mutex_unlock(&shared_lock);
     }
 }
 
@@ -136,26 +155,285 @@ void printer_proc() {
     pid  = get_proc_pid();
     time = get_sys_time();
 
-    sem_init(&sem);
+    cons_log("time=%04d pid=%02d %s started\n", time, pid, name);
 
-    cons_printf("time=%04d pid=%02d %s started\n", time, pid, name);
+    // Wait for the dispatcher to set up the shared memory lock, whichever
+    // of the two runs first
+    fsem_wait(&shared_ready);
 
     while (1) {
-        // Wait for the semaphore to be posted by the dispatcher process
-        sem_wait(&sem);
+        mutex_lock(&shared_lock);
+
+        // Sleep until the dispatcher process has new data
+        while (cached_mem == shared_mem) {
+            cond_wait(&shared_cond, &shared_lock);
+        }
+
         time = get_sys_time();
+        cons_log("time=%04d pid=%02d %s read shared memory (last pid=%d)\n",
+                 time, pid, name, shared_mem);
+        cached_mem = shared_mem;
+
+        mutex_unlock(&shared_lock);
+    }
+}
+
+// Pids of the IPC check processes, set as each starts
+static int ipc_check_server_pid = -1;
+static int ipc_check_client_pid = -1;
+
+// Calls the IPC check client makes before asking the server to exit
+#define IPC_CHECK_CALLS 3
 
-        // Only print when we have new data
-        if (cached_mem != shared_mem) {
-            cons_printf("time=%04d pid=%02d %s read shared memory (last pid=%d)\n",
-                         time, pid, name, shared_mem);
-            cached_mem = shared_mem;
+// First message word that makes the IPC check server exit
+#define IPC_CHECK_QUIT -1
+
+/**
+ * IPC check server: waits for calls before any arrive, so every call takes
+ * the direct switch path, and replies with each word plus one and the
+ * caller's pid in the last word
+ */
+void ipc_check_server() {
+    ipc_regs_t regs;
+    int client = -1;
+    int i;
+
+    ipc_check_server_pid = get_proc_pid();
+    sp_memset(&regs, 0, sizeof(regs));
+
+    while (1) {
+        client = ipc_reply_wait(client, &regs);
+
+        if (client != ipc_check_client_pid) {
+            cons_log("ipc check: FAIL server got caller %d, expected %d\n",
+                     client, ipc_check_client_pid);
+            proc_exit();
         }
+        if (regs.w[0] == IPC_CHECK_QUIT) {
+            proc_exit();
+        }
+
+        for (i = 0; i < IPC_REG_WORDS - 1; i++) {
+            regs.w[i]++;
+        }
+        regs.w[IPC_REG_WORDS - 1] = client;
+    }
+}
+
+/**
+ * IPC check client: calls the waiting server and checks each reply, then
+ * checks that a server exiting mid-call fails the call
+ */
+void ipc_check_client() {
+    ipc_regs_t regs;
+    int pid;
+    int call;
+    int i;
+
+    pid = get_proc_pid();
+    ipc_check_client_pid = pid;
 
-        // Post the semaphore so the dispatcher process can access the shared memory
-        sem_post(&sem);
+    // Let the server block in ipc_reply_wait first
+    msleep(100);
 
-        // Sleep for one second
-        sleep(1);
+    for (call = 0; call < IPC_CHECK_CALLS; call++) {
+        for (i = 0; i < IPC_REG_WORDS; i++) {
+            regs.w[i] = call * 10 + i;
+        }
+
+        if (ipc_call(ipc_check_server_pid, &regs) != 0) {
+            cons_log("ipc check: FAIL call %d returned an error\n", call);
+            proc_exit();
+        }
+        for (i = 0; i < IPC_REG_WORDS - 1; i++) {
+            if (regs.w[i] != call * 10 + i + 1) {
+                cons_log("ipc check: FAIL call %d word %d is %d\n", call, i, regs.w[i]);
+                proc_exit();
+            }
+        }
+        if (regs.w[IPC_REG_WORDS - 1] != pid) {
+            cons_log("ipc check: FAIL call %d answered for pid %d\n",
+                     call, regs.w[IPC_REG_WORDS - 1]);
+            proc_exit();
+        }
     }
+
+    regs.w[0] = IPC_CHECK_QUIT;
+    if (ipc_call(ipc_check_server_pid, &regs) != -1) {
+        cons_log("ipc check: FAIL call to an exiting server succeeded\n");
+        proc_exit();
+    }
+
+    cons_log("ipc check: ok\n");
+    proc_exit();
+}
+
+// Blocks the block cache check writes, enough to fill the cache three times
+#define BLK_CHECK_BLOCKS (BCACHE_BUFS * 3)
+
+/**
+ * Block cache check: writes more blocks than the cache holds while the
+ * drive fails some writes, so retried writes start write-backs that fail
+ * at once, then syncs and reads every block back
+ */
+void blk_check() {
+    char buf[BLOCK_SIZE];
+    int block;
+
+    for (block = 0; block < BLK_CHECK_BLOCKS; block++) {
+        sp_memset(buf, block, sizeof(buf));
+        if (blk_write(block, buf) != 0) {
+            cons_log("blk check: FAIL write of block %d\n", block);
+            proc_exit();
+        }
+    }
+
+    if (blk_sync() != 0) {
+        cons_log("blk check: FAIL sync\n");
+        proc_exit();
+    }
+
+    // Blocks whose write failed hold whatever the disk had, so only the
+    // reads themselves are checked
+    for (block = 0; block < BLK_CHECK_BLOCKS; block++) {
+        if (blk_read(block, buf) != 0) {
+            cons_log("blk check: FAIL read of block %d\n", block);
+            proc_exit();
+        }
+    }
+
+    cons_log("blk check: ok\n");
+    proc_exit();
+}
+
+void trace_proc() {
+    trace_event_t events[64];
+    char line[64];
+    int mask;
+    int count;
+    int len;
+    int i;
+
+    // Pause tracing so writing the dump does not keep adding to it
+    mask = trace_ctl(0);
+
+    len = sprintf(line, "trace begin\n");
+    serial_write(line, len, 0);
+
+    // Each batch starts with a clock record, so stop once it is all we get
+    do {
+        count = trace_read(events, 64);
+
+        for (i = 0; i < count; i++) {
+            len = sprintf(line, "ev %d %d %d %08x%08x\n",
+                          events[i].type, events[i].pid, events[i].arg,
+                          (unsigned int)(events[i].cycles >> 32),
+                          (unsigned int)events[i].cycles);
+            serial_write(line, len, 0);
+        }
+    } while (count > 1);
+
+    len = sprintf(line, "trace end\n");
+    serial_write(line, len, 0);
+
+    trace_ctl(mask);
+
+    proc_exit();
+}
+
+void prof_proc() {
+    prof_sample_t samples[64];
+    char line[64];
+    int enabled;
+    int count;
+    int len;
+    int i;
+
+    // Pause sampling so the dump only holds what ran before it
+    enabled = prof_ctl(0);
+
+    len = sprintf(line, "prof begin\n");
+    serial_write(line, len, 0);
+
+    while ((count = prof_read(samples, 64)) > 0) {
+        for (i = 0; i < count; i++) {
+            len = sprintf(line, "sample %d %08x\n", samples[i].pid, samples[i].eip);
+            serial_write(line, len, 0);
+        }
+    }
+
+    len = sprintf(line, "prof end\n");
+    serial_write(line, len, 0);
+
+    prof_ctl(enabled);
+
+    proc_exit();
+}
+
+// Time between two process table logs of top_proc
+#define TOP_INTERVAL_MS 2000
+
+// Number of times top_proc logs the process table
+#define TOP_REFRESHES 5
+
+// One letter per process state (state_t in kernel.h): ready, running,
+// sleeping, waiting
+static char *top_states = "-rRSW";
+
+// Names of the queues (proc_queue_e in kproc.h)
+static char *top_queues[] = { "cpu", "run", "idle", "sleep", "wait" };
+
+/**
+ * Logs the process table every TOP_INTERVAL_MS, TOP_REFRESHES times;
+ * %CPU is each process' share of the time since the previous log
+ */
+void top_proc() {
+    proc_stat_t procs[PROC_MAX];
+    unsigned int last_cpu_us[PROC_MAX];
+    char last_name[PROC_MAX][PROC_NAME_LEN+1];
+    timespec_t now;
+    timespec_t last;
+    unsigned int elapsed_us;
+    unsigned int used_us;
+    unsigned int pct;
+    int count;
+    int round;
+    int i;
+
+    sp_memset(last_cpu_us, 0, sizeof(last_cpu_us));
+    sp_memset(last_name, 0, sizeof(last_name));
+    clock_gettime(&last);
+
+    for (round = 0; round < TOP_REFRESHES; round++) {
+        msleep(TOP_INTERVAL_MS);
+
+        count = proc_snapshot(procs, PROC_MAX);
+        clock_gettime(&now);
+        elapsed_us = (now.tv_sec - last.tv_sec) * 1000000
+                   + (now.tv_nsec - last.tv_nsec) / 1000;
+        last = now;
+
+        cons_log("PID NAME             S PRI QUEUE  %%CPU   CPU(ms)  TICKS   VOL INVOL WAIT(ms) BLKD(ms)\n");
+        for (i = 0; i < count; i++) {
+            proc_stat_t *p = &procs[i];
+
+            // A pid reused by a new process starts its share from zero
+            if (sp_strcmp(last_name[p->pid], p->name) != 0
+                || p->cpu_us < last_cpu_us[p->pid]) {
+                last_cpu_us[p->pid] = 0;
+                sp_strcpy(last_name[p->pid], p->name);
+            }
+            used_us = p->cpu_us - last_cpu_us[p->pid];
+            last_cpu_us[p->pid] = p->cpu_us;
+            pct = elapsed_us ? used_us / (elapsed_us / 100 + 1) : 0;
+
+            cons_log("%3d %-16s %c %3d %-5s %4u %9u %6d %5d %5d %8u %8u\n",
+                     p->pid, p->name, top_states[p->state], p->priority,
+                     top_queues[p->queue], pct, p->cpu_us / 1000, p->cpu_ticks,
+                     p->voluntary, p->involuntary,
+                     p->wait_us / 1000, p->blocked_us / 1000);
+        }
+    }
+
+    proc_exit();
 }
@@ -15,4 +15,21 @@ void user_proc();
 void dispatcher_proc();
 void printer_proc();
 
+// Check synchronous IPC when the server is already waiting for calls
+void ipc_check_server();
+void ipc_check_client();
+
+// Check the block cache while the drive fails writes
+#define BLK_CHECK_FAILS 8
+void blk_check();
+
+// Writes the kernel trace to the serial port
+void trace_proc();
+
+// Writes the profiler samples to the serial port
+void prof_proc();
+
+// Logs the process table a few times, top style
+void top_proc();
+
 #endif